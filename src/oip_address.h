@@ -0,0 +1,103 @@
+#ifndef OIP_ADDRESS_H
+#define OIP_ADDRESS_H
+
+#include <cctype>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+// Parsers for PLC tag addresses. They work on plain strings so they can be tested
+// without Godot; OIPComms overloads them for String and passes the utf8 of the tag name.
+
+inline bool oip_all_digits(const std::string &text, size_t start, size_t end) {
+	if (start >= end)
+		return false;
+	for (size_t i = start; i < end; i++) {
+		if (text[i] < '0' || text[i] > '9')
+			return false;
+	}
+	return true;
+}
+
+// splits an array element name into its base and index: "Data[12]" -> "Data[", 12 and
+// "N7:12" -> "N7:", 12. max_span is how many elements fit into one request - PLC-5/SLC
+// reads are limited to a single packet, so only data files with a known element size
+// (N, F, L) are coalesced. Logix reads are fragmented by libplctag and have no limit
+inline bool oip_split_element(const std::string &tag_name, std::string &base, int &index, int &max_span) {
+	size_t open = std::string::npos;
+	size_t close = tag_name.length();
+	if (!tag_name.empty() && tag_name.back() == ']') {
+		open = tag_name.rfind('[');
+		close = tag_name.length() - 1;
+		max_span = INT32_MAX;
+	} else {
+		open = tag_name.find(':');
+		if (open == std::string::npos || open <= 1 || tag_name.find(':', open + 1) != std::string::npos)
+			return false;
+		const char file_type = tag_name[0];
+		if (file_type == 'N')
+			max_span = 118;
+		else if (file_type == 'F' || file_type == 'L')
+			max_span = 59;
+		else
+			return false;
+		if (!oip_all_digits(tag_name, 1, open))
+			return false;
+	}
+	if (open == std::string::npos || open == 0 || close - open > 10 || !oip_all_digits(tag_name, open + 1, close))
+		return false;
+
+	base = tag_name.substr(0, open + 1);
+	index = std::atoi(tag_name.substr(open + 1, close - open - 1).c_str());
+	return true;
+}
+
+// splits the address of a single bit into the tag holding it and the bit number:
+// "Word.5" -> "Word", 5 and "Bits[37]" -> "Bits", 37
+inline bool oip_split_bit(const std::string &tag_name, std::string &base, int &bit) {
+	const bool element = !tag_name.empty() && tag_name.back() == ']';
+	const size_t open = element ? tag_name.rfind('[') : tag_name.rfind('.');
+	const size_t close = element ? tag_name.length() - 1 : tag_name.length();
+	if (open == std::string::npos || open == 0 || close - open > 10 || !oip_all_digits(tag_name, open + 1, close))
+		return false;
+
+	base = tag_name.substr(0, open);
+	bit = std::atoi(tag_name.substr(open + 1, close - open - 1).c_str());
+	return true;
+}
+
+// Modbus tags are addressed by table and 0-based address as libplctag names them, "hr12",
+// "ir12", "co12", "di12", or by 1-based Modicon number where the first digit is the table,
+// "40013" or "400013" for the same holding register
+inline bool oip_modbus_address(const std::string &tag_name, std::string &table, int &address) {
+	std::string prefix = tag_name.substr(0, 2);
+	for (char &c : prefix)
+		c = (char)std::tolower((unsigned char)c);
+
+	size_t start = 0;
+	table.clear();
+	if (prefix == "hr" || prefix == "ir" || prefix == "co" || prefix == "di") {
+		table = prefix;
+		start = 2;
+	}
+	const size_t length = tag_name.length() - start;
+	if (length > 9 || !oip_all_digits(tag_name, start, tag_name.length()))
+		return false;
+
+	if (table.empty()) {
+		if (length != 5 && length != 6)
+			return false;
+		static const char *tables[] = { "co", "di", "", "ir", "hr" };
+		const int table_index = tag_name[0] - '0';
+		if (table_index > 4 || table_index == 2)
+			return false;
+		table = tables[table_index];
+		address = std::atoi(tag_name.c_str() + 1) - 1;
+		return address >= 0;
+	}
+	address = std::atoi(tag_name.c_str() + start);
+	return true;
+}
+
+#endif
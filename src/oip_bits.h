@@ -0,0 +1,40 @@
+#ifndef OIP_BITS_H
+#define OIP_BITS_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OIP_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace godot {
+
+// one byte per bit, 0 or 1, least significant bit of each byte first
+inline void oip_unpack_bits_scalar(const uint8_t *packed, size_t size, uint8_t *bits) {
+	for (size_t i = 0; i < size; i++) {
+		for (int bit = 0; bit < 8; bit++) {
+			bits[i * 8 + bit] = (packed[i] >> bit) & 1;
+		}
+	}
+}
+
+inline void oip_unpack_bits(const uint8_t *packed, size_t size, uint8_t *bits) {
+	size_t i = 0;
+#ifdef OIP_SSE2
+	// two bytes at a time: each byte is repeated across 8 lanes, which test one bit each
+	const __m128i masks = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+	const __m128i ones = _mm_set1_epi8(1);
+	for (; i + 2 <= size; i += 2) {
+		const __m128i repeated = _mm_unpacklo_epi64(_mm_set1_epi8((char)packed[i]), _mm_set1_epi8((char)packed[i + 1]));
+		const __m128i set = _mm_cmpeq_epi8(_mm_and_si128(repeated, masks), masks);
+		_mm_storeu_si128((__m128i *)(bits + i * 8), _mm_and_si128(set, ones));
+	}
+#endif
+	oip_unpack_bits_scalar(packed + i, size - i, bits + i * 8);
+}
+
+} //namespace godot
+
+#endif
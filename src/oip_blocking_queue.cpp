@@ -23,6 +23,34 @@ String OIPBlockingQueue::pop() {
 	return message;
 }
 
+// takes the front message if there is one, without waiting
+bool OIPBlockingQueue::try_pop(String &message) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (queue.empty())
+		return false;
+
+	message = queue.front();
+	queue.pop();
+	return true;
+}
+
+// waits up to timeout for a message, false when none came. after shutdown an empty
+// message is returned like pop() does
+bool OIPBlockingQueue::pop_for(String &message, std::chrono::microseconds timeout) {
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!cv.wait_for(lock, timeout, [this]() { return !queue.empty() || stop; }))
+		return false;
+
+	if (stop && queue.empty()) {
+		message = "";
+		return true;
+	}
+
+	message = queue.front();
+	queue.pop();
+	return true;
+}
+
 void OIPBlockingQueue::shutdown() {
 	{
 		std::lock_guard<std::mutex> lock(mutex);
@@ -30,3 +58,8 @@ void OIPBlockingQueue::shutdown() {
 	}
 	cv.notify_all(); // Wake up all threads so they can exit
 }
+
+size_t OIPBlockingQueue::size() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return queue.size();
+}
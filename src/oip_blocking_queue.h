@@ -3,6 +3,7 @@
 
 #include <godot_cpp/variant/string.hpp>
 
+#include <chrono>
 #include <queue>
 #include <thread>
 #include <mutex>
@@ -21,7 +22,10 @@ private:
 public:
 	void push(const String message);
     String pop();
+    bool try_pop(String &message);
+    bool pop_for(String &message, std::chrono::microseconds timeout);
     void shutdown();
+    size_t size();
 };
 
 } //namespace godot
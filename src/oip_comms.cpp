@@ -1,15 +1,381 @@
 #include "oip_comms.h"
+#include "oip_address.h"
+#include "oip_bits.h"
+#include "oip_create_batch.h"
 #include <godot_cpp/classes/engine.hpp>
 #include <godot_cpp/classes/object.hpp>
 #include <godot_cpp/classes/os.hpp>
+#include <godot_cpp/classes/project_settings.hpp>
 #include <godot_cpp/classes/scene_tree.hpp>
 #include <godot_cpp/classes/time.hpp>
 #include <godot_cpp/core/class_db.hpp>
 #include <godot_cpp/variant/utility_functions.hpp>
 
+#include <chrono>
+#include <cstring>
+
 using namespace godot;
 
+static std::string oip_utf8(const String &text) {
+	return std::string(text.utf8().get_data());
+}
+
+// type names match the read_/write_ suffixes, indexes match WriteRequest::instruction
+static int oip_type_index(const String &type_name) {
+	static const char *type_names[] = { "bit", "uint64", "int64", "uint32", "int32", "uint16", "int16", "uint8", "int8", "float64", "float32" };
+	for (int i = 0; i < 11; i++) {
+		if (type_name == type_names[i])
+			return i;
+	}
+	return -1;
+}
+
+static int oip_type_size(int type) {
+	static const int type_sizes[] = { 1, 8, 8, 4, 4, 2, 2, 1, 1, 8, 4 };
+	return type >= 0 && type < 11 ? type_sizes[type] : 0;
+}
+
+// value of a write request in the layout of the PLC buffers, returns its size in bytes
+static size_t oip_encode_value(const Variant &value, int instruction, uint8_t *bytes) {
+	size_t size = oip_type_size(instruction);
+	switch (instruction) {
+		case 0: {
+			bool bit = value;
+			bytes[0] = bit ? 1 : 0;
+		} break;
+		case 1: {
+			uint64_t raw_value = value;
+			memcpy(bytes, &raw_value, size);
+		} break;
+		case 2: {
+			int64_t raw_value = value;
+			memcpy(bytes, &raw_value, size);
+		} break;
+		case 3: {
+			uint32_t raw_value = value;
+			memcpy(bytes, &raw_value, size);
+		} break;
+		case 4: {
+			int32_t raw_value = value;
+			memcpy(bytes, &raw_value, size);
+		} break;
+		case 5: {
+			uint16_t raw_value = value;
+			memcpy(bytes, &raw_value, size);
+		} break;
+		case 6: {
+			int16_t raw_value = value;
+			memcpy(bytes, &raw_value, size);
+		} break;
+		case 7: {
+			uint8_t raw_value = value;
+			memcpy(bytes, &raw_value, size);
+		} break;
+		case 8: {
+			int8_t raw_value = value;
+			memcpy(bytes, &raw_value, size);
+		} break;
+		case 9: {
+			double raw_value = value;
+			memcpy(bytes, &raw_value, size);
+		} break;
+		case 10: {
+			float raw_value = value;
+			memcpy(bytes, &raw_value, size);
+		} break;
+		default:
+			return 0;
+	}
+	return size;
+}
+
+// pointer free scalars and arrays are compared with a single memcmp, anything else
+// (strings, structures) falls back to open62541's deep comparison
+static bool oip_variant_equal(const UA_Variant &a, const UA_Variant &b) {
+	if (a.type != b.type || a.arrayLength != b.arrayLength || a.data == nullptr || b.data == nullptr)
+		return false;
+	if (a.type->pointerFree) {
+		size_t count = UA_Variant_isScalar(&a) ? 1 : a.arrayLength;
+		return memcmp(a.data, b.data, a.type->memSize * count) == 0;
+	}
+	return UA_order(&a, &b, &UA_TYPES[UA_TYPES_VARIANT]) == UA_ORDER_EQ;
+}
+
+static bool oip_variant_to_double(const UA_Variant &value, double &result) {
+	if (!UA_Variant_isScalar(&value) || value.data == nullptr)
+		return false;
+
+	switch (value.type->typeKind) {
+		case UA_DATATYPEKIND_SBYTE:
+			result = *(UA_SByte *)value.data;
+			return true;
+		case UA_DATATYPEKIND_BYTE:
+			result = *(UA_Byte *)value.data;
+			return true;
+		case UA_DATATYPEKIND_INT16:
+			result = *(UA_Int16 *)value.data;
+			return true;
+		case UA_DATATYPEKIND_UINT16:
+			result = *(UA_UInt16 *)value.data;
+			return true;
+		case UA_DATATYPEKIND_INT32:
+			result = *(UA_Int32 *)value.data;
+			return true;
+		case UA_DATATYPEKIND_UINT32:
+			result = *(UA_UInt32 *)value.data;
+			return true;
+		case UA_DATATYPEKIND_INT64:
+			result = (double)*(UA_Int64 *)value.data;
+			return true;
+		case UA_DATATYPEKIND_UINT64:
+			result = (double)*(UA_UInt64 *)value.data;
+			return true;
+		case UA_DATATYPEKIND_FLOAT:
+			result = *(UA_Float *)value.data;
+			return true;
+		case UA_DATATYPEKIND_DOUBLE:
+			result = *(UA_Double *)value.data;
+			return true;
+		default:
+			return false;
+	}
+}
+
+// borrows the characters of range, empty is no range at all
+static UA_String oip_index_range(const std::string &range) {
+	if (range.empty())
+		return UA_STRING_NULL;
+	UA_String index_range = { range.size(), (UA_Byte *)range.data() };
+	return index_range;
+}
+
+static int64_t oip_unix_usec(UA_DateTime date_time) {
+	return date_time != 0 ? (date_time - UA_DATETIME_UNIX_EPOCH) / UA_DATETIME_USEC : 0;
+}
+
+// tag paths in the NodeId notation are parsed as such: "ns=3;i=1042", "ns=2;s=Line1.Speed",
+// "g=..." or "b=...", where a missing ns= takes the namespace of the group. any other path is
+// a string id in the group's namespace, as tags have always been addressed
+static bool oip_parse_node_id(const String &tag_path, const String &group_namespace, UA_NodeId &node_id) {
+	const UA_UInt16 namespace_index = (UA_UInt16)group_namespace.to_int();
+	const String prefix = tag_path.substr(0, 2);
+	String notation = tag_path;
+	if (prefix == "i=" || prefix == "s=" || prefix == "g=" || prefix == "b=") {
+		notation = "ns=" + itos(namespace_index) + ";" + tag_path;
+	} else if (!tag_path.begins_with("ns=")) {
+		node_id = UA_NODEID_STRING_ALLOC(namespace_index, tag_path.utf8().get_data());
+		return true;
+	}
+
+	const CharString chars = notation.utf8();
+	UA_NodeId_init(&node_id);
+	return UA_NodeId_parse(&node_id, UA_STRING((char *)chars.get_data())) == UA_STATUSCODE_GOOD;
+}
+
+static bool oip_valid_index_range(const String &index_range) {
+	if (index_range.is_empty())
+		return true;
+	const CharString range = index_range.utf8();
+	UA_NumericRange numeric_range;
+	if (UA_NumericRange_parse(&numeric_range, UA_STRING((char *)range.get_data())) != UA_STATUSCODE_GOOD)
+		return false;
+	UA_free(numeric_range.dimensions);
+	return true;
+}
+
+static size_t oip_variant_count(const UA_Variant &value) {
+	return UA_Variant_isScalar(&value) ? 1 : value.arrayLength;
+}
+
+// arrays whose elements are laid out the same on both sides take a single memcpy
+template <typename P>
+static Variant oip_packed_copy(const void *data, size_t count) {
+	P packed;
+	packed.resize(count);
+	if (count > 0)
+		memcpy(packed.ptrw(), data, count * sizeof(*packed.ptr()));
+	return packed;
+}
+
+// the others are widened element by element
+template <typename P, typename T>
+static Variant oip_packed_convert(const void *data, size_t count) {
+	P packed;
+	packed.resize(count);
+	const T *elements = (const T *)data;
+	for (size_t i = 0; i < count; i++) {
+		packed.set(i, elements[i]);
+	}
+	return packed;
+}
+
+// numeric OPC UA values to the closest Packed*Array, scalars as an array of one
+static Variant oip_variant_to_packed(const UA_Variant &value) {
+	if (value.type == nullptr || value.data == nullptr)
+		return Variant();
+
+	const size_t count = oip_variant_count(value);
+	switch (value.type->typeKind) {
+		case UA_DATATYPEKIND_BOOLEAN:
+		case UA_DATATYPEKIND_BYTE:
+			return oip_packed_copy<PackedByteArray>(value.data, count);
+		case UA_DATATYPEKIND_SBYTE:
+			return oip_packed_convert<PackedInt32Array, UA_SByte>(value.data, count);
+		case UA_DATATYPEKIND_INT16:
+			return oip_packed_convert<PackedInt32Array, UA_Int16>(value.data, count);
+		case UA_DATATYPEKIND_UINT16:
+			return oip_packed_convert<PackedInt32Array, UA_UInt16>(value.data, count);
+		case UA_DATATYPEKIND_INT32:
+			return oip_packed_copy<PackedInt32Array>(value.data, count);
+		case UA_DATATYPEKIND_UINT32:
+			return oip_packed_convert<PackedInt64Array, UA_UInt32>(value.data, count);
+		case UA_DATATYPEKIND_INT64:
+		case UA_DATATYPEKIND_UINT64:
+			return oip_packed_copy<PackedInt64Array>(value.data, count);
+		case UA_DATATYPEKIND_FLOAT:
+			return oip_packed_copy<PackedFloat32Array>(value.data, count);
+		case UA_DATATYPEKIND_DOUBLE:
+			return oip_packed_copy<PackedFloat64Array>(value.data, count);
+		default:
+			return Variant();
+	}
+}
+
+template <typename T>
+static void oip_convert_elements(const T *elements, size_t count, const UA_DataType *type, void *data) {
+	for (size_t i = 0; i < count; i++) {
+		switch (type->typeKind) {
+			case UA_DATATYPEKIND_BOOLEAN:
+				((UA_Boolean *)data)[i] = elements[i] != 0;
+				break;
+			case UA_DATATYPEKIND_SBYTE:
+				((UA_SByte *)data)[i] = (UA_SByte)elements[i];
+				break;
+			case UA_DATATYPEKIND_BYTE:
+				((UA_Byte *)data)[i] = (UA_Byte)elements[i];
+				break;
+			case UA_DATATYPEKIND_INT16:
+				((UA_Int16 *)data)[i] = (UA_Int16)elements[i];
+				break;
+			case UA_DATATYPEKIND_UINT16:
+				((UA_UInt16 *)data)[i] = (UA_UInt16)elements[i];
+				break;
+			case UA_DATATYPEKIND_INT32:
+				((UA_Int32 *)data)[i] = (UA_Int32)elements[i];
+				break;
+			case UA_DATATYPEKIND_UINT32:
+				((UA_UInt32 *)data)[i] = (UA_UInt32)elements[i];
+				break;
+			case UA_DATATYPEKIND_INT64:
+				((UA_Int64 *)data)[i] = (UA_Int64)elements[i];
+				break;
+			case UA_DATATYPEKIND_UINT64:
+				((UA_UInt64 *)data)[i] = (UA_UInt64)elements[i];
+				break;
+			case UA_DATATYPEKIND_FLOAT:
+				((UA_Float *)data)[i] = (UA_Float)elements[i];
+				break;
+			case UA_DATATYPEKIND_DOUBLE:
+				((UA_Double *)data)[i] = (UA_Double)elements[i];
+				break;
+		}
+	}
+}
+
+// fills array with the elements of a packed array as type, or as the packed array's own
+// type when type is null. the elements are copied with a single memcpy when the types match
+template <typename P>
+static bool oip_packed_to_variant(const P &packed, const UA_DataType *packed_type, const UA_DataType *type, UA_Variant &array) {
+	if (type == nullptr)
+		type = packed_type;
+	if (type->typeKind > UA_DATATYPEKIND_DOUBLE)
+		return false;
+
+	const size_t count = packed.size();
+	if (type == packed_type)
+		return UA_Variant_setArrayCopy(&array, packed.ptr(), count, type) == UA_STATUSCODE_GOOD;
+
+	void *data = UA_Array_new(count, type);
+	if (data == nullptr && count > 0)
+		return false;
+	oip_convert_elements(packed.ptr(), count, type, data);
+	UA_Variant_setArray(&array, data, count, type);
+	return true;
+}
+
+// protocols whose tags live in memory instead of behind a libplctag handle
+static bool oip_memory_protocol(const String &protocol) {
+	return protocol == "replay" || protocol == "sim";
+}
+
+static bool oip_libplctag_protocol(const String &protocol) {
+	return protocol != "opc_ua" && !oip_memory_protocol(protocol);
+}
+
+// accessors for tag memory, laid out the same as the libplctag buffers (little endian)
+template <typename T>
+static T oip_memory_get(const std::vector<uint8_t> &memory, int offset) {
+	T value = 0;
+	if (offset >= 0 && (size_t)offset + sizeof(T) <= memory.size())
+		memcpy(&value, memory.data() + offset, sizeof(T));
+	return value;
+}
+
+static bool oip_memory_get_bit(const std::vector<uint8_t> &memory, int bit_offset) {
+	if (bit_offset < 0 || (size_t)bit_offset / 8 >= memory.size())
+		return false;
+	return (memory[bit_offset / 8] >> (bit_offset % 8)) & 1;
+}
+
+#define OIP_MEMORY_GET(a, b) \
+static b oip_memory_get_##a(const std::vector<uint8_t> &memory, int offset) { \
+	return oip_memory_get<b>(memory, offset); \
+}
+
+OIP_MEMORY_GET(uint64, uint64_t)
+OIP_MEMORY_GET(int64, int64_t)
+OIP_MEMORY_GET(uint32, uint32_t)
+OIP_MEMORY_GET(int32, int32_t)
+OIP_MEMORY_GET(uint16, uint16_t)
+OIP_MEMORY_GET(int16, int16_t)
+OIP_MEMORY_GET(uint8, uint8_t)
+OIP_MEMORY_GET(int8, int8_t)
+OIP_MEMORY_GET(float64, double)
+OIP_MEMORY_GET(float32, float)
+
+static Variant oip_memory_value(const std::vector<uint8_t> &memory, uint8_t type, int offset, int bit) {
+	switch (type) {
+		case 0:
+			return oip_memory_get_bit(memory, offset * 8 + (bit >= 0 ? bit : 0));
+		case 1:
+			return oip_memory_get_uint64(memory, offset);
+		case 2:
+			return oip_memory_get_int64(memory, offset);
+		case 3:
+			return oip_memory_get_uint32(memory, offset);
+		case 4:
+			return oip_memory_get_int32(memory, offset);
+		case 5:
+			return oip_memory_get_uint16(memory, offset);
+		case 6:
+			return oip_memory_get_int16(memory, offset);
+		case 7:
+			return oip_memory_get_uint8(memory, offset);
+		case 8:
+			return oip_memory_get_int8(memory, offset);
+		case 9:
+			return oip_memory_get_float64(memory, offset);
+		case 10:
+			return oip_memory_get_float32(memory, offset);
+	}
+	return Variant();
+}
+
 OIPComms::OIPComms() {
+	// the singleton is created on the main thread
+	main_thread_id = std::this_thread::get_id();
+	profiler.name_thread("Main thread");
+
 	print("Process work start");
 	work_thread.instantiate();
 	work_thread->start(callable_mp(this, &OIPComms::process_work));
@@ -17,18 +383,27 @@ OIPComms::OIPComms() {
 	print("Watchdog thread start");
 	watchdog_thread.instantiate();
 	watchdog_thread->start(callable_mp(this, &OIPComms::watchdog));
+
+	print("Tick thread start");
+	tick_thread.instantiate();
+	tick_thread->start(callable_mp(this, &OIPComms::tick));
 }
 
 OIPComms::~OIPComms() {
-	cleanup_tag_groups();
+	recorder.stop();
 
 	watchdog_thread_running = false;
+	tick_thread_running = false;
 	work_thread_running = false;
 	tag_group_queue.shutdown();
 
 	work_thread->wait_to_finish();
 	watchdog_thread->wait_to_finish();
+	tick_thread->wait_to_finish();
 	print("Threads shutdown");
+
+	// after the worker, which may still be completing OPC UA requests on the shared clients
+	cleanup_tag_groups();
 }
 
 void OIPComms::cleanup_tag_groups() {
@@ -36,58 +411,442 @@ void OIPComms::cleanup_tag_groups() {
 		const String tag_group_name = x.first;
 		cleanup_tag_group(tag_group_name);
 	}
+
+	// rebuilt from the configuration on the next work item
+	tag_groups.clear();
+	synced_config_version = 0;
+	plc_tags_created = false;
 }
 
 void OIPComms::cleanup_tag_group(const String &tag_group_name) {
 	TagGroup &tag_group = tag_groups[tag_group_name];
 
-	print("Cleaning up tags");
+	print_format(OIPLogger::LEVEL_INFO, "Cleaning up tags");
 
 	if (tag_group.protocol == "opc_ua") {
+		std::lock_guard<std::mutex> lock(opc_ua_values_mutex);
 		for (auto &x : tag_group.opc_ua_tags) {
 			OpcUaTag &tag = x.second;
-			UA_Variant_clear(&tag.value);
+			tag.slot->reset();
+			UA_NodeId_clear(&tag.node_id);
+			UA_NodeId_clear(&tag.registered_node_id);
 		}
 
+		// a read still out completes as stale once the group lets go of the client
+		tag_group.read_in_flight = false;
+		tag_group.nodes_registered = false;
+		tag_group.opc_ua_session = 0;
 		if (tag_group.client != nullptr) {
-			UA_Client_delete(tag_group.client);
 			tag_group.client = nullptr;
+			release_opc_ua_client(tag_group.gateway);
 		}
 		tag_group.opc_ua_tags.clear();
 
 	} else {
+		std::lock_guard<std::mutex> lock(plc_memory_mutex);
 		for (auto &x : tag_group.plc_tags) {
 			PlcTag &tag = x.second;
 			plc_tag_destroy(tag.tag_pointer);
+			if (tag.slot != nullptr)
+				tag.slot->reset();
+		}
+		for (auto &x : tag_group.plc_members) {
+			PlcMember &member = x.second;
+			if (member.write_pointer >= 0)
+				plc_tag_destroy(member.write_pointer);
+			member.slot->reset();
 		}
 		tag_group.plc_tags.clear();
+		tag_group.plc_members.clear();
+		tag_group.replay.reset();
+		tag_group.sim_values.clear();
+
+		tag_group.read_in_flight = false;
+		tag_group.sim_busy_usec = 0;
+		for (auto request_it = sim_requests.begin(); request_it != sim_requests.end();) {
+			if (request_it->second.tag_group_name == tag_group_name)
+				request_it = sim_requests.erase(request_it);
+			else
+				++request_it;
+		}
 	}
 	tag_group.init_count = 0;
-	tag_group.init_count_emitted = false;
+	tag_group.slot->ready = false;
+}
+
+// brings the runtime state in line with a published configuration. groups which were
+// registered again come back with a new slot and are rebuilt from scratch, tags are only
+// ever added
+void OIPComms::sync_tag_groups(const CommsConfig &comms_config) {
+	if (comms_config.version == synced_config_version)
+		return;
+
+	for (auto tag_group_it = tag_groups.begin(); tag_group_it != tag_groups.end();) {
+		auto config_it = comms_config.tag_groups.find(tag_group_it->first);
+		if (config_it == comms_config.tag_groups.end() || config_it->second->slot != tag_group_it->second.slot) {
+			cleanup_tag_group(tag_group_it->first);
+			tag_group_it = tag_groups.erase(tag_group_it);
+		} else {
+			++tag_group_it;
+		}
+	}
+
+	for (const auto &x : comms_config.tag_groups) {
+		const TagGroupConfig &tag_group_config = *x.second;
+		auto tag_group_it = tag_groups.find(x.first);
+		if (tag_group_it == tag_groups.end()) {
+			TagGroup tag_group;
+			tag_group.slot = tag_group_config.slot;
+			tag_group.protocol = tag_group_config.protocol;
+			tag_group.timeout = tag_group_config.timeout;
+			tag_group.gateway = tag_group_config.gateway;
+			tag_group.path = tag_group_config.path;
+			tag_group.cpu = tag_group_config.cpu;
+			tag_group_it = tag_groups.emplace(x.first, tag_group).first;
+		}
+
+		// groups left alone since the last sync still share their version
+		if (tag_group_it->second.config_version != tag_group_config.version)
+			sync_tag_group(tag_group_it->second, tag_group_config);
+	}
+	synced_config_version = comms_config.version;
+}
+
+void OIPComms::sync_tag_group(TagGroup &tag_group, const TagGroupConfig &tag_group_config) {
+	for (const auto &x : tag_group_config.tags) {
+		const String &tag_name = x.first;
+		const TagConfig &tag_config = x.second;
+
+		Deadband *deadband = nullptr;
+		if (tag_group.protocol == "opc_ua") {
+			auto tag_it = tag_group.opc_ua_tags.find(tag_name);
+			if (tag_it == tag_group.opc_ua_tags.end()) {
+				OpcUaTag tag = { false, UA_NODEID_NULL, UA_NODEID_NULL };
+				tag.slot = tag_config.slot;
+				tag_it = tag_group.opc_ua_tags.emplace(tag_name, tag).first;
+			}
+			tag_it->second.index_range = tag_config.index_range.utf8().get_data();
+			deadband = &tag_it->second.deadband;
+
+		} else if (!tag_config.owner_tag_name.is_empty()) {
+			// UDT field or bit. the UDT tag or bit field sorts before its members, so it is already there
+			auto owner_it = tag_group.plc_tags.find(tag_config.owner_tag_name);
+			const TagConfig &owner_config = tag_group_config.tags.at(tag_config.owner_tag_name);
+			if (owner_it == tag_group.plc_tags.end() || tag_config.field_index >= (int)owner_config.fields.size())
+				continue;
+
+			PlcMember member = { tag_config.owner_tag_name, tag_config.bit_index / 8, tag_config.bit_index % 8, -1, 0, 1, 0, Deadband(), tag_config.slot };
+			if (tag_config.field_index >= 0) {
+				const PlcField &field = owner_config.fields[tag_config.field_index];
+				member = { tag_config.owner_tag_name, field.offset, field.bit, -1, 0, oip_type_size(field.type), field.type, Deadband(), tag_config.slot };
+			}
+			if (tag_config.type >= 0)
+				member.type = tag_config.type;
+
+			// a UDT registered again with another layout, or a name first registered as a tag of
+			// its own, replaces what was there
+			auto member_it = tag_group.plc_members.find(tag_name);
+			const bool same = member_it != tag_group.plc_members.end() && member_it->second.tag_name == member.tag_name && member_it->second.offset == member.offset && member_it->second.bit == member.bit && member_it->second.size == member.size;
+			if (same) {
+				member_it->second.type = member.type;
+			} else {
+				remove_plc_tag(tag_group, tag_name);
+				tag_group.plc_members[tag_name] = member;
+
+				PlcTag &owner = owner_it->second;
+				owner.members.push_back(tag_name);
+				if (owner.initialized)
+					plc_publish_view(tag_group, owner);
+			}
+			deadband = &tag_group.plc_members[tag_name].deadband;
+
+		} else if (plc_coalesced(tag_group, tag_name)) {
+			PlcMember &member = tag_group.plc_members[tag_name];
+			if (tag_config.type >= 0)
+				member.type = tag_config.type;
+			deadband = &member.deadband;
+
+		} else {
+			// a field dropped from its UDT's layout
+			if (tag_group.plc_members.find(tag_name) != tag_group.plc_members.end())
+				remove_plc_tag(tag_group, tag_name);
+
+			auto tag_it = tag_group.plc_tags.find(tag_name);
+			if (tag_it == tag_group.plc_tags.end()) {
+				PlcTag tag = { false, -1, tag_config.elem_count, false };
+				tag.slot = tag_config.slot;
+				tag_it = tag_group.plc_tags.emplace(tag_name, tag).first;
+			}
+			PlcTag &tag = tag_it->second;
+
+			// the sim buffer of a UDT is sized for its layout
+			const bool relayout = tag.fields.size() != tag_config.fields.size() || !std::equal(tag.fields.begin(), tag.fields.end(), tag_config.fields.begin(), [](const PlcField &a, const PlcField &b) {
+				return a.offset == b.offset && a.bit == b.bit && a.type == b.type;
+			});
+			if (relayout && tag_group.protocol == "sim" && tag.initialized) {
+				tag.initialized = false;
+				tag_group.init_count--;
+				tag_group.sim_values.erase(tag_name);
+			}
+			tag.fields = tag_config.fields;
+			tag.type = tag_config.type;
+			deadband = &tag.deadband;
+		}
+
+		deadband->absolute = tag_config.deadband;
+		deadband->percent = tag_config.deadband_percent;
+	}
+	tag_group.config_version = tag_group_config.version;
+}
+
+// an element folded into a block read by coalesce_plc_tags
+bool OIPComms::plc_coalesced(const TagGroup &tag_group, const String &tag_name) {
+	auto member_it = tag_group.plc_members.find(tag_name);
+	if (member_it == tag_group.plc_members.end())
+		return false;
+	auto owner_it = tag_group.plc_tags.find(member_it->second.tag_name);
+	return owner_it != tag_group.plc_tags.end() && owner_it->second.block;
+}
+
+// drops a tag or member the configuration no longer has in that form. its slot stays, the
+// tag replacing it publishes into the same one
+void OIPComms::remove_plc_tag(TagGroup &tag_group, const String &tag_name) {
+	std::lock_guard<std::mutex> lock(plc_memory_mutex);
+
+	auto member_it = tag_group.plc_members.find(tag_name);
+	if (member_it != tag_group.plc_members.end()) {
+		PlcMember &member = member_it->second;
+		auto owner_it = tag_group.plc_tags.find(member.tag_name);
+		if (owner_it != tag_group.plc_tags.end()) {
+			std::vector<String> &members = owner_it->second.members;
+			members.erase(std::remove(members.begin(), members.end(), tag_name), members.end());
+		}
+		if (member.write_pointer >= 0)
+			plc_tag_destroy(member.write_pointer);
+		member.slot->reset();
+		tag_group.plc_members.erase(member_it);
+	}
+
+	auto tag_it = tag_group.plc_tags.find(tag_name);
+	if (tag_it != tag_group.plc_tags.end()) {
+		PlcTag &tag = tag_it->second;
+		if (tag.tag_pointer >= 0 || tag.initialized) {
+			if (tag.tag_pointer >= 0)
+				plc_tag_destroy(tag.tag_pointer);
+			if (tag_group.init_count > 0)
+				tag_group.init_count--;
+		}
+		if (tag.slot != nullptr)
+			tag.slot->reset();
+		tag_group.sim_values.erase(tag_name);
+		tag_group.plc_tags.erase(tag_it);
+	}
 }
 
 void OIPComms::watchdog() {
+	profiler.name_thread("OIPComms watchdog");
 	while (watchdog_thread_running) {
-		if (!scene_signals_set) {
-			SceneTree *main_scene = Object::cast_to<SceneTree>(Engine::get_singleton()->get_main_loop());
-			if (main_scene != nullptr) {
-				main_scene->connect("process_frame", callable_mp(this, &OIPComms::process));
-				print("Scene signals set");
-				scene_signals_set = true;
+		// the scene tree is only touched on the main thread, one attempt is queued at a time
+		if (!scene_signals_set && !scene_signals_queued.exchange(true))
+			callable_mp(this, &OIPComms::connect_scene_signals).call_deferred();
+
+		check_stall();
+		OS::get_singleton()->delay_msec(100);
+	}
+}
+
+// marks the I/O call the worker is about to block in, for the watchdog
+void OIPComms::io_begin(const String &tag_group_name, const String &tag_name, const char *operation, int32_t tag_pointer) {
+	std::lock_guard<std::mutex> lock(in_flight_mutex);
+	in_flight.tag_group_name = tag_group_name;
+	in_flight.tag_name = tag_name;
+	in_flight.operation = operation;
+	in_flight.tag_pointer = tag_pointer;
+	in_flight.start_usec = Time::get_singleton()->get_ticks_usec();
+	in_flight.reported = false;
+}
+
+void OIPComms::io_end() {
+	std::lock_guard<std::mutex> lock(in_flight_mutex);
+	if (in_flight.start_usec != 0 && profiler.is_enabled())
+		profiler.record(in_flight.operation, in_flight.tag_group_name + "/" + in_flight.tag_name, in_flight.start_usec, Time::get_singleton()->get_ticks_usec());
+	in_flight.tag_pointer = -1;
+	in_flight.start_usec = 0;
+}
+
+// a stall is an I/O call running past the threshold, or a worker which has not taken the next
+// item in that time while there is work waiting. each one is reported once
+void OIPComms::check_stall() {
+	const uint64_t now = Time::get_singleton()->get_ticks_usec();
+	const uint64_t threshold_usec = (uint64_t)std::max(stall_threshold.load(), 1) * 1000;
+	const uint64_t heartbeat = worker_heartbeat;
+	const uint64_t heartbeat_age = heartbeat != 0 && now > heartbeat ? now - heartbeat : 0;
+
+	std::lock_guard<std::mutex> lock(in_flight_mutex);
+	Stall stall = { in_flight.tag_group_name, in_flight.tag_name, in_flight.operation, 0, heartbeat_age / 1000, 0, false };
+	if (in_flight.start_usec != 0 && !in_flight.reported && now - in_flight.start_usec >= threshold_usec) {
+		in_flight.reported = true;
+		stall.elapsed_msec = (now - in_flight.start_usec) / 1000;
+
+		// libplctag returns PLCTAG_ERR_ABORT from the blocked call, the tag itself stays usable
+		if (abort_stalled && in_flight.tag_pointer >= 0) {
+			plc_tag_abort(in_flight.tag_pointer);
+			stall.aborted = true;
+		}
+	} else if (in_flight.start_usec == 0 && heartbeat != stalled_heartbeat && heartbeat_age >= threshold_usec && tag_group_queue.size() > 0) {
+		stalled_heartbeat = heartbeat;
+		stall.operation = "busy";
+		stall.elapsed_msec = heartbeat_age / 1000;
+	} else {
+		return;
+	}
+	stall.queued = tag_group_queue.size();
+
+	std::lock_guard<std::mutex> stalls_lock(stalls_mutex);
+	stalls.push_back(stall);
+}
+
+void OIPComms::emit_stalls() {
+	std::vector<Stall> found;
+	{
+		std::lock_guard<std::mutex> lock(stalls_mutex);
+		found.swap(stalls);
+	}
+	for (const Stall &stall : found) {
+		print("Comms stalled in " + stall.operation + " of " + stall.tag_group_name + "/" + stall.tag_name + " for " + itos(stall.elapsed_msec) + " ms" + (stall.aborted ? ", aborted" : ""), true);
+
+		Dictionary diagnostics;
+		diagnostics["tag_group_name"] = stall.tag_group_name;
+		diagnostics["tag_name"] = stall.tag_name;
+		diagnostics["operation"] = stall.operation;
+		diagnostics["elapsed_msec"] = stall.elapsed_msec;
+		diagnostics["heartbeat_age_msec"] = stall.heartbeat_age_msec;
+		diagnostics["queued"] = (int64_t)stall.queued;
+		diagnostics["aborted"] = stall.aborted;
+		emit_signal("comms_stalled", diagnostics);
+	}
+}
+
+// main thread, queued by the watchdog until the scene tree is there
+void OIPComms::connect_scene_signals() {
+	scene_signals_queued = false;
+	if (!scene_signals_set && connect_process_clock()) {
+		print_format(OIPLogger::LEVEL_INFO, "Scene signals set");
+		scene_signals_set = true;
+	}
+}
+
+// connects process() to the frame signal of the current clock, moving it over when the clock
+// changed. main thread only
+bool OIPComms::connect_process_clock() {
+	SceneTree *main_scene = Object::cast_to<SceneTree>(Engine::get_singleton()->get_main_loop());
+	if (main_scene == nullptr)
+		return false;
+
+	std::lock_guard<std::mutex> lock(process_clock_mutex);
+	const String signal_name = process_clock == "physics_frame" ? "physics_frame" : "process_frame";
+	if (signal_name == connected_clock)
+		return true;
+
+	const Callable callable = callable_mp(this, &OIPComms::process);
+	if (!connected_clock.is_empty())
+		main_scene->disconnect(connected_clock, callable);
+	main_scene->connect(signal_name, callable);
+	connected_clock = signal_name;
+	return true;
+}
+
+// fixed clock: queues the groups at a steady rate, independent of the frame rate
+void OIPComms::tick() {
+	profiler.name_thread("OIPComms tick");
+	std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+	while (tick_thread_running) {
+		if (!fixed_clock) {
+			OS::get_singleton()->delay_msec(50);
+			next = std::chrono::steady_clock::now();
+			continue;
+		}
+
+		const std::chrono::microseconds period(1000000 / std::max(fixed_tick_rate.load(), 1));
+		next += period;
+
+		// after a stall (breakpoint, suspended machine) the missed ticks are dropped, not caught up
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (next < now)
+			next = now + period;
+		std::this_thread::sleep_until(next);
+
+		if (!enable_comms.load() || !sim_running.load())
+			continue;
+
+		std::lock_guard<std::mutex> lock(tick_mutex);
+		for (TickGroup &tick_group : tick_schedule) {
+			tick_group.time += period.count() / 1000.0;
+			if (tick_group.time >= tick_group.slot->interval) {
+				queue_tag_group(tick_group.tag_group_name);
+				tick_polled.push_back(tick_group.tag_group_name);
+				tick_group.time = 0.0;
 			}
 		}
+	}
+}
+
+// carries the time since the last poll over for groups which are still there
+void OIPComms::update_tick_schedule() {
+	if (tick_schedule_version == published_config_version)
+		return;
 
-		OS::get_singleton()->delay_msec(500);
+	std::lock_guard<std::mutex> lock(tick_mutex);
+	std::map<String, double> times;
+	for (const TickGroup &tick_group : tick_schedule) {
+		times[tick_group.tag_group_name] = tick_group.time;
 	}
+
+	tick_schedule.clear();
+	for (const auto &x : config_draft->tag_groups) {
+		const std::shared_ptr<TagGroupSlot> &slot = x.second->slot;
+		auto time_it = times.find(x.first);
+		tick_schedule.push_back({ x.first, slot, time_it != times.end() ? time_it->second : slot->interval * 1.0 });
+	}
+	tick_schedule_version = published_config_version;
 }
 
 void OIPComms::process_work() {
+	profiler.name_thread("OIPComms worker");
 	while (work_thread_running) {
-		// this pop operation is blocking - thread will sleep until a request comes along
-		String tag_group_name = tag_group_queue.pop();
+		// OPC UA requests are out or sim requests will come due. the wait for work is cut short
+		// so their completions are taken in between, from sockets which never block
+		uint64_t wait_usec = opc_ua_requests_in_flight() > 0 ? OPC_UA_ITERATE_USEC : UINT64_MAX;
+		if (!sim_requests.empty()) {
+			const uint64_t now = Time::get_singleton()->get_ticks_usec();
+			const uint64_t due_usec = sim_requests.begin()->first;
+			wait_usec = std::min(wait_usec, due_usec > now ? due_usec - now : 0);
+		}
+
+		String tag_group_name;
+		if (wait_usec != UINT64_MAX) {
+			if (!tag_group_queue.pop_for(tag_group_name, std::chrono::microseconds(wait_usec))) {
+				iterate_opc_ua_clients();
+				complete_sim_requests();
+				continue;
+			}
+		} else {
+			// this pop operation is blocking - thread will sleep until a request comes along
+			const uint64_t wait_usec = profiler.is_enabled() ? Time::get_singleton()->get_ticks_usec() : 0;
+			tag_group_name = tag_group_queue.pop();
+			if (wait_usec != 0)
+				profiler.record("queue_wait", tag_group_name, wait_usec, Time::get_singleton()->get_ticks_usec());
+		}
 
 		if (tag_group_name.is_empty() && !work_thread_running)
 			break;
+		worker_heartbeat = Time::get_singleton()->get_ticks_usec();
+
+		// pick up tags and groups registered since the last item
+		const CommsConfig *comms_config = config.pin();
+		if (comms_config != nullptr)
+			sync_tag_groups(*comms_config);
+		config.unpin();
 
 		bool custom_instruction = false;
 		if (tag_group_name == "_CLEANUP_TAG_GROUPS") {
@@ -99,17 +858,21 @@ void OIPComms::process_work() {
 		flush_all_writes();
 
 		// only actually process if sim running
-		if (sim_running) {
+		if (sim_running.load()) {
 			if (tag_groups.find(tag_group_name) != tag_groups.end()) {
 				process_tag_group(tag_group_name);
 			} else {
 				if (tag_group_name.is_empty()) {
-					print("Processing writes (no tag groups to be updated)");
+					print_format(OIPLogger::LEVEL_INFO, "Processing writes (no tag groups to be updated)");
 				} else {
-					if (!custom_instruction) print("Tag group not found: " + tag_group_name, true);
+					if (!custom_instruction) print_format(OIPLogger::LEVEL_ERROR, "Tag group not found: {0}", tag_group_name);
 				}
 			}
 		}
+
+		// completions which arrived or came due meanwhile, without waiting for more
+		iterate_opc_ua_clients();
+		complete_sim_requests();
 	}
 }
 
@@ -117,72 +880,217 @@ void OIPComms::queue_tag_group(const String &tag_group_name) {
 	tag_group_queue.push(tag_group_name);
 }
 
+// the empty item wakes the worker, which flushes the writes before anything else
+void OIPComms::queue_write(const WriteRequest &write_req) {
+	{
+		std::lock_guard<std::mutex> lock(write_queue_mutex);
+		write_queue.push(write_req);
+	}
+	tag_group_queue.push("");
+}
+
 void OIPComms::flush_all_writes() {
-	while (!write_queue.empty()) {
-		WriteRequest write_req = write_queue.front();
-		write_queue.pop();
-		if (sim_running)
+	std::queue<WriteRequest> writes;
+	{
+		std::lock_guard<std::mutex> lock(write_queue_mutex);
+		writes.swap(write_queue);
+	}
+	while (!writes.empty()) {
+		WriteRequest write_req = writes.front();
+		writes.pop();
+		if (sim_running.load())
 			process_write(write_req);
 	}
 }
 
 // not currently used but might considering flushing one write for each read
 void OIPComms::flush_one_write() {
-	if (!write_queue.empty()) {
-		WriteRequest write_req = write_queue.front();
+	WriteRequest write_req;
+	{
+		std::lock_guard<std::mutex> lock(write_queue_mutex);
+		if (write_queue.empty())
+			return;
+		write_req = write_queue.front();
 		write_queue.pop();
-		if (sim_running)
-			process_write(write_req);
 	}
+	if (sim_running.load())
+		process_write(write_req);
 }
 
-void OIPComms::opc_write(const String &tag_group_name, const String &tag_path) {
-	if (!opc_ua_client_connected(tag_group_name))
-		return;
+// a client lost since the last poll is reconnected for the write. a write which cannot go
+// out is reported, never dropped silently
+bool OIPComms::opc_ua_write_ready(const String &tag_group_name, const String &tag_path) {
+	if (!opc_ua_client_connected(tag_group_name) && !init_opc_ua_client(tag_group_name)) {
+		print_format(OIPLogger::LEVEL_ERROR, "OPC UA write to {0} dropped, tag group {1} is not connected", tag_path, tag_group_name);
+		return false;
+	}
 
-	TagGroup &tag_group = tag_groups[tag_group_name];
+	OpcUaTag &tag = tag_groups[tag_group_name].opc_ua_tags[tag_path];
+	if (!tag.initialized)
+		init_opc_ua_tag(tag_group_name, tag_path);
+	return true;
+}
 
+// the write storage of the tag was filled by the caller, after opc_ua_write_ready
+void OIPComms::opc_write(const String &tag_group_name, const String &tag_path) {
+	TagGroup &tag_group = tag_groups[tag_group_name];
 	OpcUaTag &tag = tag_group.opc_ua_tags[tag_path];
-	if (!tag.initialized)
+
+	// the value is encoded as the request goes out, the write storage is free again after
+	io_begin(tag_group_name, tag_path, "write");
+	OpcUaWrite *write = reserve_opc_ua_write(tag_group.gateway, tag_group_name, tag_path);
+	UA_StatusCode ret_val = write != nullptr ? UA_Client_writeValueAttribute_async(tag_group.client, opc_ua_node_id(tag), &(tag.write_value), opc_ua_write_callback, write, nullptr) : UA_STATUSCODE_BADCONNECTIONCLOSED;
+	io_end();
+	if (ret_val != UA_STATUSCODE_GOOD) {
+		if (write != nullptr)
+			release_opc_ua_write(*write, tag_group.client);
+		print_format(OIPLogger::LEVEL_ERROR, "OIP Comms: Failed to write tag value for {0} with status code {code}", tag_path, Variant(), Variant(), UA_StatusCode_name(ret_val));
+	}
+}
+
+// reserves a request on the client and takes a free write context for it. the pool holds
+// one context per request the client may have out, so one is free once the request is
+OIPComms::OpcUaWrite *OIPComms::reserve_opc_ua_write(const String &gateway, const String &tag_group_name, const String &tag_path) {
+	if (!reserve_opc_ua_request(gateway))
+		return nullptr;
+
+	OpcUaClient &shared = opc_ua_clients[gateway];
+	for (OpcUaWrite &write : shared.writes) {
+		if (!write.in_use) {
+			write.in_use = true;
+			write.comms = this;
+			write.gateway = gateway;
+			write.tag_group_name = tag_group_name;
+			write.tag_path = tag_path;
+			write.start_usec = Time::get_singleton()->get_ticks_usec();
+			return &write;
+		}
+	}
+	complete_opc_ua_request(gateway, shared.client);
+	return nullptr;
+}
+
+void OIPComms::release_opc_ua_write(OpcUaWrite &write, UA_Client *client) {
+	complete_opc_ua_request(write.gateway, client);
+	write.in_use = false;
+}
+
+void OIPComms::opc_ua_write_callback(UA_Client *client, void *userdata, UA_UInt32 request_id, UA_WriteResponse *response) {
+	OpcUaWrite *write = (OpcUaWrite *)userdata;
+	OIPComms *comms = write->comms;
+	if (comms->profiler.is_enabled())
+		comms->profiler.record("opc_ua_write", write->tag_group_name + "/" + write->tag_path, write->start_usec, Time::get_singleton()->get_ticks_usec(), true);
+
+	UA_StatusCode ret_val = response->responseHeader.serviceResult;
+	if (ret_val == UA_STATUSCODE_GOOD && response->resultsSize == 1)
+		ret_val = response->results[0];
+	if (ret_val != UA_STATUSCODE_GOOD) {
+		comms->print_format(OIPLogger::LEVEL_ERROR, "OIP Comms: Failed to write tag value for {0} with status code {code}", write->tag_path, Variant(), Variant(), UA_StatusCode_name(ret_val));
+	}
+	comms->release_opc_ua_write(*write, client);
+}
+
+// the array is written in the type of the node's last polled value, which is only known
+// once it has been read. until then it goes out in the packed array's own type
+void OIPComms::opc_write_array(const WriteRequest &write_req) {
+	if (!opc_ua_write_ready(write_req.tag_group_name, write_req.tag_name))
+		return;
+
+	TagGroup &tag_group = tag_groups[write_req.tag_group_name];
+	OpcUaTag &tag = tag_group.opc_ua_tags[write_req.tag_name];
+
+	// only the worker replaces the polled value, no lock needed to look at it here
+	const UA_Variant &current = tag.slot->value;
+	const UA_DataType *type = current.type != nullptr && current.type->typeKind <= UA_DATATYPEKIND_DOUBLE ? current.type : nullptr;
+
+	UA_WriteValue item;
+	UA_WriteValue_init(&item);
+	bool encoded = false;
+	switch (write_req.value.get_type()) {
+		case Variant::PACKED_BYTE_ARRAY:
+			encoded = oip_packed_to_variant((PackedByteArray)write_req.value, &UA_TYPES[UA_TYPES_BYTE], type, item.value.value);
+			break;
+		case Variant::PACKED_INT32_ARRAY:
+			encoded = oip_packed_to_variant((PackedInt32Array)write_req.value, &UA_TYPES[UA_TYPES_INT32], type, item.value.value);
+			break;
+		case Variant::PACKED_INT64_ARRAY:
+			encoded = oip_packed_to_variant((PackedInt64Array)write_req.value, &UA_TYPES[UA_TYPES_INT64], type, item.value.value);
+			break;
+		case Variant::PACKED_FLOAT32_ARRAY:
+			encoded = oip_packed_to_variant((PackedFloat32Array)write_req.value, &UA_TYPES[UA_TYPES_FLOAT], type, item.value.value);
+			break;
+		case Variant::PACKED_FLOAT64_ARRAY:
+			encoded = oip_packed_to_variant((PackedFloat64Array)write_req.value, &UA_TYPES[UA_TYPES_DOUBLE], type, item.value.value);
+			break;
+		default:
+			break;
+	}
+	if (!encoded) {
+		print_format(OIPLogger::LEVEL_ERROR, "OIP Comms: Supplied data type incorrect for {0}", write_req.tag_name);
 		return;
+	}
+
+	// a whole matrix keeps its dimensions
+	const std::string index_range = write_req.index_range.is_empty() ? tag.index_range : std::string(write_req.index_range.utf8().get_data());
+	if (index_range.empty() && current.arrayDimensionsSize > 0 && current.arrayLength == item.value.value.arrayLength) {
+		if (UA_Array_copy(current.arrayDimensions, current.arrayDimensionsSize, (void **)&item.value.value.arrayDimensions, &UA_TYPES[UA_TYPES_UINT32]) == UA_STATUSCODE_GOOD)
+			item.value.value.arrayDimensionsSize = current.arrayDimensionsSize;
+	}
+	item.value.hasValue = true;
+
+	// the request only borrows the node id and range
+	item.nodeId = opc_ua_node_id(tag);
+	item.attributeId = UA_ATTRIBUTEID_VALUE;
+	item.indexRange = oip_index_range(index_range);
+
+	UA_WriteRequest request;
+	UA_WriteRequest_init(&request);
+	request.nodesToWrite = &item;
+	request.nodesToWriteSize = 1;
+
+	io_begin(write_req.tag_group_name, write_req.tag_name, "write");
+	OpcUaWrite *write = reserve_opc_ua_write(tag_group.gateway, write_req.tag_group_name, write_req.tag_name);
+	UA_StatusCode ret_val = write != nullptr ? UA_Client_sendAsyncWriteRequest(tag_group.client, &request, opc_ua_write_callback, write, nullptr) : UA_STATUSCODE_BADCONNECTIONCLOSED;
+	io_end();
+	UA_Variant_clear(&item.value.value);
 
-	UA_StatusCode ret_val = UA_Client_writeValueAttribute(tag_group.client, tag.node_id, &(tag.value));
 	if (ret_val != UA_STATUSCODE_GOOD) {
-		print("OIP Comms: Failed to write tag value for " + tag_path + " with status code " + String(UA_StatusCode_name(ret_val)), true);
+		if (write != nullptr)
+			release_opc_ua_write(*write, tag_group.client);
+		print_format(OIPLogger::LEVEL_ERROR, "OIP Comms: Failed to write tag value for {0} with status code {code}", write_req.tag_name, Variant(), Variant(), UA_StatusCode_name(ret_val));
 	}
 }
 
-#define OIP_OPC_SET(a, b, c, d) \
+#define OIP_OPC_SET(a, b, c, d, e) \
 void OIPComms::opc_tag_set_##a(const String &tag_group_name, const String &tag_path, const godot::Variant value) { \
 	if (value.get_type() == Variant::d) { \
-		if (!opc_ua_client_connected(tag_group_name)) return; \
+		if (!opc_ua_write_ready(tag_group_name, tag_path)) return; \
 		OpcUaTag &tag = tag_groups[tag_group_name].opc_ua_tags[tag_path]; \
-		if (!tag.initialized) return; \
-		b raw_value = (b)value; \
-		UA_StatusCode ret_val = UA_Variant_setScalarCopy(&(tag.value), &raw_value, &UA_TYPES[UA_TYPES_##c]); \
-		if (ret_val != UA_STATUSCODE_GOOD) \
-			print("OIP Comms: Failed to cast data on write for " + tag_path, true); \
+		e raw_value = (e)(b)value; \
+		UA_Variant_setScalar(&(tag.write_value), &(tag.write_data), &UA_TYPES[UA_TYPES_##c]); \
+		tag.write_value.storageType = UA_VARIANT_DATA_NODELETE; \
+		memcpy(&(tag.write_data), &raw_value, sizeof(raw_value)); \
 		opc_write(tag_group_name, tag_path); \
 	} else { \
-		print("OIP Comms: Supplied data type incorrect for " + tag_path, true); \
+		print_format(OIPLogger::LEVEL_ERROR, "OIP Comms: Supplied data type incorrect for {0}", tag_path); \
 	} \
 }
 
 /* Data marshalling is a giant PITA in this project
 libplctag, open62541 and Godot have different names for each of the fundamental data types
-Godot variants support direct casting, while open62541 needs to use UA_Variant_setScalarCopy()
+Godot variants support direct casting, while open62541 variants are pointed at the tag's write storage
 */
-OIP_OPC_SET(bit, bool, BOOLEAN, BOOL)
-OIP_OPC_SET(uint64, uint64_t, UINT64, INT)
-OIP_OPC_SET(int64, int64_t, INT64, INT)
-OIP_OPC_SET(uint32, uint32_t, UINT32, INT)
-OIP_OPC_SET(int32, int32_t, INT32, INT)
-OIP_OPC_SET(uint16, uint16_t, UINT16, INT)
-OIP_OPC_SET(int16, int16_t, INT16, INT)
-OIP_OPC_SET(uint8, uint8_t, UINT16, INT) // there's no 8 bit integer types in OPC UA
-OIP_OPC_SET(int8, int8_t, INT16, INT)
-OIP_OPC_SET(float64, double, DOUBLE, FLOAT)
-OIP_OPC_SET(float32, float, FLOAT, FLOAT)
+OIP_OPC_SET(bit, bool, BOOLEAN, BOOL, UA_Boolean)
+OIP_OPC_SET(uint64, uint64_t, UINT64, INT, UA_UInt64)
+OIP_OPC_SET(int64, int64_t, INT64, INT, UA_Int64)
+OIP_OPC_SET(uint32, uint32_t, UINT32, INT, UA_UInt32)
+OIP_OPC_SET(int32, int32_t, INT32, INT, UA_Int32)
+OIP_OPC_SET(uint16, uint16_t, UINT16, INT, UA_UInt16)
+OIP_OPC_SET(int16, int16_t, INT16, INT, UA_Int16)
+OIP_OPC_SET(uint8, uint8_t, UINT16, INT, UA_UInt16) // there's no 8 bit integer types in OPC UA
+OIP_OPC_SET(int8, int8_t, INT16, INT, UA_Int16)
+OIP_OPC_SET(float64, double, DOUBLE, FLOAT, UA_Double)
+OIP_OPC_SET(float32, float, FLOAT, FLOAT, UA_Float)
 
 #define OIP_SET_CALL(a) \
 if (tag_group.protocol == "opc_ua") { \
@@ -192,12 +1100,42 @@ if (tag_group.protocol == "opc_ua") { \
 }
 
 void OIPComms::process_write(const WriteRequest &write_req) {
-	TagGroup &tag_group = tag_groups[write_req.tag_group_name];
+	auto tag_group_it = tag_groups.find(write_req.tag_group_name);
+	if (tag_group_it == tag_groups.end())
+		return;
+	TagGroup &tag_group = tag_group_it->second;
+
+	// a tag registered this frame reaches the worker with the next published configuration
+	const bool tag_known = tag_group.protocol == "opc_ua" ?
+			tag_group.opc_ua_tags.count(write_req.tag_name) > 0 :
+			tag_group.plc_tags.count(write_req.tag_name) > 0 || tag_group.plc_members.count(write_req.tag_name) > 0;
+	if (!tag_known)
+		return;
+
+	if (recorder.is_recording())
+		record_write(write_req);
+
+	// a replay has nothing to write to
+	if (tag_group.protocol == "replay") {
+		print_format(OIPLogger::LEVEL_INFO, "Replay write to {0}/{1}: {2}", write_req.tag_group_name, write_req.tag_name, write_req.value);
+		return;
+	}
+	if (tag_group.protocol == "sim") {
+		process_sim_write(write_req);
+		return;
+	}
 
 	int32_t tag_pointer = -1;
+	PlcMember *member = nullptr;
 	if (tag_group.protocol != "opc_ua") {
-		PlcTag &tag = tag_group.plc_tags[write_req.tag_name];
-		tag_pointer = tag.tag_pointer;
+		auto member_it = tag_group.plc_members.find(write_req.tag_name);
+		if (member_it != tag_group.plc_members.end()) {
+			member = &member_it->second;
+			tag_pointer = plc_member_write_pointer(tag_group, write_req.tag_name, *member);
+		} else {
+			PlcTag &tag = tag_group.plc_tags[write_req.tag_name];
+			tag_pointer = tag.tag_pointer;
+		}
 	}
 
 	switch (write_req.instruction) {
@@ -234,82 +1172,721 @@ void OIPComms::process_write(const WriteRequest &write_req) {
 		case 10:
 			OIP_SET_CALL(float32)
 			break;
+		case 11:
+			// write_array only queues arrays for OPC UA groups
+			opc_write_array(write_req);
+			return;
 	}
 
 	// this code only need for PLC interface - the above code is "setting" the data in memory
 	// this code actually writes to the PLC tags
 	if (tag_group.protocol != "opc_ua") {
-		if (tag_pointer >= 0 && plc_tag_write(tag_pointer, timeout) == PLCTAG_STATUS_OK) {
-			tag_groups[write_req.tag_group_name].plc_tags[write_req.tag_name].dirty = true;
+		int write_result = PLCTAG_ERR_NOT_FOUND;
+		if (tag_pointer >= 0) {
+			io_begin(write_req.tag_group_name, write_req.tag_name, "write", tag_pointer);
+			const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+			write_result = plc_tag_write(tag_pointer, plc_timeout(tag_group));
+			plc_rtt_sample(tag_group, start_usec, write_result);
+			io_end();
+		}
+		if (write_result == PLCTAG_STATUS_OK) {
+			if (member != nullptr) {
+				PlcTag &owner = tag_group.plc_tags[member->tag_name];
+				plc_mirror_member_write(owner, *member);
+				owner.dirty = true;
+			} else {
+				tag_group.plc_tags[write_req.tag_name].dirty = true;
+			}
 		} else {
-			print("Failed to write tag: " + write_req.tag_name, true);
+			print_format(OIPLogger::LEVEL_ERROR, "Failed to write tag: {0}", write_req.tag_name);
 		}
 	}
 }
 
 void OIPComms::process_tag_group(const String &tag_group_name) {
+	OIPProfiler::Scope span(profiler, "poll", tag_group_name);
 	TagGroup &tag_group = tag_groups[tag_group_name];
+
+	// OPC UA and sim polls complete asynchronously and report themselves
 	if (tag_group.protocol == "opc_ua") {
 		process_opc_ua_tag_group(tag_group_name);
+		return;
+	}
+	if (tag_group.protocol == "sim") {
+		process_sim_tag_group(tag_group_name);
+		return;
+	}
+
+	tag_group.poll_seq++;
+	tag_group.poll_tags_read = 0;
+	tag_group.poll_tags_changed = 0;
+	tag_group.poll_failures = 0;
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+
+	if (tag_group.protocol == "replay") {
+		process_replay_tag_group(tag_group_name);
 	} else {
 		process_plc_tag_group(tag_group_name);
 	}
+
+	push_poll_completion(tag_group_name, tag_group, start_usec);
 }
 
-void OIPComms::process_plc_tag_group(const String &tag_group_name) {
+void OIPComms::push_poll_completion(const String &tag_group_name, const TagGroup &tag_group, uint64_t start_usec) {
+	PollCompletion completion = { tag_group_name, tag_group.poll_seq, start_usec, Time::get_singleton()->get_ticks_usec(), tag_group.poll_tags_read, tag_group.poll_tags_changed, tag_group.poll_failures };
+	std::lock_guard<std::mutex> lock(poll_completions_mutex);
+	poll_completions.push_back(completion);
+}
+
+void OIPComms::process_plc_tag_group(const String &tag_group_name) {
 	TagGroup &tag_group = tag_groups[tag_group_name];
+
+	if (tag_group.init_count < tag_group.plc_tags.size()) {
+		if (!plc_tags_created) {
+			// first poll after the sim starts - create the tags of every PLC group in one pass
+			std::vector<String> plc_tag_group_names;
+			for (auto const &x : tag_groups) {
+				if (oip_libplctag_protocol(x.second.protocol))
+					plc_tag_group_names.push_back(x.first);
+			}
+			create_plc_tags(plc_tag_group_names);
+			plc_tags_created = true;
+		} else {
+			// retry the tags of this group which failed to create (or were registered late)
+			create_plc_tags({ tag_group_name });
+		}
+	}
+
+	if (tag_group.init_count >= tag_group.plc_tags.size())
+		tag_group.slot->ready = true;
+
+	const uint64_t now = Time::get_singleton()->get_ticks_usec();
+	PackedStringArray changed;
 	for (auto &x : tag_group.plc_tags) {
 		const String tag_name = x.first;
 		PlcTag &tag = x.second;
 
-		// tag is not initialized
+		// tag failed to create, it gets retried on the next poll
 		if (tag.tag_pointer < 0) {
-			if (!init_plc_tag(tag_group_name, tag_name))
-				break;
+			tag_group.poll_failures++;
+			continue;
 		}
 
-		// tag is initialized, read it
-		if (tag.tag_pointer >= 0) {
-			if (!process_plc_read(tag, tag_name)) {
-				print("Skipping remainder of tag group: " + tag_group_name);
-				break;
+		if (plc_tag_idle(tag_group, tag, now)) {
+			demand_skipped_reads++;
+			demand_skipped_bytes += tag.image.size();
+			continue;
+		}
+
+		if (!process_plc_read(tag_group_name, tag_group, tag, tag_name)) {
+			tag_group.poll_failures++;
+			print_format(OIPLogger::LEVEL_WARNING, "Skipping remainder of tag group: {0}", tag_group_name);
+			break;
+		} else {
+			// if read was successful, the tag read is now clean
+			tag.dirty = false;
+			tag_group.poll_tags_read += (tag.block ? 0 : 1) + (int)tag.members.size();
+			diff_plc_tag(tag_group_name, tag_group, tag_name, tag, changed);
+		}
+	}
+	queue_value_changes(tag_group_name, changed);
+}
+
+// compares the buffer of a PLC tag against the previous poll. plain and UDT tags are
+// reported by their own name, members by theirs when their bytes changed. the first
+// poll after the tag is created reports everything
+void OIPComms::diff_plc_tag(const String &tag_group_name, TagGroup &tag_group, const String &tag_name, PlcTag &tag, PackedStringArray &changed) {
+	int size;
+	if (tag.tag_pointer >= 0) {
+		size = plc_tag_get_size(tag.tag_pointer);
+		if (size <= 0)
+			return;
+		plc_read_buffer.resize(size);
+		if (plc_tag_get_raw_bytes(tag.tag_pointer, 0, plc_read_buffer.data(), size) != PLCTAG_STATUS_OK)
+			return;
+	} else {
+		// memory is only written by the worker, no lock needed to read it here
+		size = (int)tag.slot->memory.size();
+		if (size <= 0)
+			return;
+		plc_read_buffer.assign(tag.slot->memory.begin(), tag.slot->memory.end());
+	}
+
+	if (recorder.is_recording())
+		recorder.record(OIPRecorder::RECORD_POLL, plc_trace_id(tag_group_name, tag_group, tag_name, tag), OIPRecorder::TYPE_RAW, plc_read_buffer.data(), size);
+
+	const uint8_t *current = plc_read_buffer.data();
+	const uint8_t *previous = tag.image.data();
+	bool first = tag.image.size() != (size_t)size;
+	if (!first && memcmp(previous, current, size) == 0)
+		return;
+
+	// coalesced blocks are not registered by the scripts, only their elements are
+	if (!tag.block) {
+		if (!tag.deadband.enabled() || plc_deadband_exceeded(tag, tag.type, 0, tag.deadband))
+			changed.push_back(tag_name);
+	}
+
+	for (const String &member_name : tag.members) {
+		PlcMember &member = tag_group.plc_members[member_name];
+		int offset = plc_member_offset(tag, member);
+
+		bool member_changed = first;
+		if (!first && member.bit >= 0) {
+			int byte = offset + member.bit / 8;
+			member_changed = byte < size && ((current[byte] ^ previous[byte]) >> (member.bit % 8)) & 1;
+		} else if (!first) {
+			int member_size = member.size > 0 ? member.size : tag.elem_size;
+			member_changed = offset + member_size <= size && memcmp(previous + offset, current + offset, member_size) != 0;
+		}
+		if (member_changed && member.deadband.enabled() && member.bit < 0) {
+			member_changed = plc_deadband_exceeded(tag, member.type, offset, member.deadband);
+		}
+		if (member_changed)
+			changed.push_back(member_name);
+	}
+
+	tag.image.swap(plc_read_buffer);
+}
+
+// type is the UDT layout type or the one registered with the tag. PLC tags carry no type of
+// their own and the bytes alone can't tell an integer from a float, so without one every
+// change goes through. register_tag refuses a deadband without a type in the first place
+bool OIPComms::plc_deadband_exceeded(const PlcTag &tag, int type, int offset, Deadband &deadband) {
+	if (type <= 0)
+		return true;
+
+	double value = plc_tag_value(tag, type, offset, -1);
+	return deadband.exceeded(value, deadband.reported, deadband.has_reported);
+}
+
+// the first record of a tag in a recording defines it, along with every member served from it
+uint32_t OIPComms::plc_trace_id(const String &tag_group_name, TagGroup &tag_group, const String &tag_name, PlcTag &tag) {
+	const uint32_t session = recorder.get_session();
+	if (tag.trace_session != session) {
+		tag.trace_id = recorder.define_tag(oip_utf8(tag_group_name), oip_utf8(tag_name));
+		tag.trace_session = session;
+		for (const String &member_name : tag.members) {
+			PlcMember &member = tag_group.plc_members[member_name];
+			member.trace_id = recorder.define_member(oip_utf8(tag_group_name), oip_utf8(member_name), tag.trace_id, plc_member_offset(tag, member), member.bit);
+			member.trace_session = session;
+		}
+	}
+	return tag.trace_id;
+}
+
+// only plain data is recorded - strings and structures are skipped
+void OIPComms::record_opc_ua_value(const String &tag_group_name, const String &tag_path, OpcUaTag &tag) {
+	const UA_Variant &value = tag.slot->value;
+	if (value.type == nullptr || !value.type->pointerFree || value.data == nullptr)
+		return;
+
+	const uint32_t session = recorder.get_session();
+	if (tag.trace_session != session) {
+		tag.trace_id = recorder.define_tag(oip_utf8(tag_group_name), oip_utf8(tag_path));
+		tag.trace_session = session;
+	}
+
+	size_t count = UA_Variant_isScalar(&value) ? 1 : value.arrayLength;
+	recorder.record(OIPRecorder::RECORD_POLL, tag.trace_id, OIPRecorder::TYPE_OPC_UA | value.type->typeKind, (const uint8_t *)value.data, value.type->memSize * count);
+}
+
+// writes are recorded as requested, in the type of the write_* call
+void OIPComms::record_write(const WriteRequest &write_req) {
+	uint8_t bytes[8];
+	size_t size = oip_encode_value(write_req.value, write_req.instruction, bytes);
+	if (size == 0)
+		return;
+
+	TagGroup &tag_group = tag_groups[write_req.tag_group_name];
+	uint32_t trace_id = 0;
+	if (tag_group.protocol == "opc_ua") {
+		OpcUaTag &tag = tag_group.opc_ua_tags[write_req.tag_name];
+		if (tag.trace_session != recorder.get_session()) {
+			tag.trace_id = recorder.define_tag(oip_utf8(write_req.tag_group_name), oip_utf8(write_req.tag_name));
+			tag.trace_session = recorder.get_session();
+		}
+		trace_id = tag.trace_id;
+	} else {
+		auto member_it = tag_group.plc_members.find(write_req.tag_name);
+		if (member_it != tag_group.plc_members.end()) {
+			PlcMember &member = member_it->second;
+			plc_trace_id(write_req.tag_group_name, tag_group, member.tag_name, tag_group.plc_tags[member.tag_name]);
+			trace_id = member.trace_id;
+		} else {
+			trace_id = plc_trace_id(write_req.tag_group_name, tag_group, write_req.tag_name, tag_group.plc_tags[write_req.tag_name]);
+		}
+	}
+	recorder.record(OIPRecorder::RECORD_WRITE, trace_id, write_req.instruction, bytes, size);
+}
+
+void OIPComms::queue_value_changes(const String &tag_group_name, const PackedStringArray &changed) {
+	if (changed.is_empty())
+		return;
+
+	auto tag_group_it = tag_groups.find(tag_group_name);
+	if (tag_group_it != tag_groups.end())
+		tag_group_it->second.poll_tags_changed += changed.size();
+
+	std::lock_guard<std::mutex> lock(value_changes_mutex);
+	value_changes.push_back({ tag_group_name, changed });
+}
+
+// every change since the last frame goes out in a single signal, keyed by tag group. a group
+// polled more than once in the frame lists each of its tags once. once the deadline passed
+// the changes wait for the next frame, but never for more than one, so they can't starve
+int OIPComms::emit_value_changes(uint64_t deadline) {
+	if (deadline > 0 && !value_changes_held && Time::get_singleton()->get_ticks_usec() >= deadline) {
+		std::lock_guard<std::mutex> lock(value_changes_mutex);
+		value_changes_held = !value_changes.empty();
+		return value_changes_held ? 1 : 0;
+	}
+	value_changes_held = false;
+
+	std::vector<ValueChange> changes;
+	{
+		std::lock_guard<std::mutex> lock(value_changes_mutex);
+		changes.swap(value_changes);
+	}
+	if (changes.empty())
+		return 0;
+
+	Dictionary changed;
+	for (const ValueChange &change : changes) {
+		if (!changed.has(change.tag_group_name)) {
+			changed[change.tag_group_name] = change.tag_names;
+			continue;
+		}
+		PackedStringArray tag_names = changed[change.tag_group_name];
+		for (int i = 0; i < change.tag_names.size(); i++) {
+			if (!tag_names.has(change.tag_names[i]))
+				tag_names.push_back(change.tag_names[i]);
+		}
+		changed[change.tag_group_name] = tag_names;
+	}
+	emit_signal("tag_values_changed", changed);	return 0;
+}
+
+// every poll finished since the last frame, in the order the worker finished them. these
+// wait entirely once the deadline passed
+int OIPComms::emit_poll_completions(uint64_t deadline) {
+	std::vector<PollCompletion> completions;
+	{
+		std::lock_guard<std::mutex> lock(poll_completions_mutex);
+		completions.swap(poll_completions);
+	}
+
+	size_t emitted = 0;
+	for (; emitted < completions.size(); emitted++) {
+		if (deadline > 0 && Time::get_singleton()->get_ticks_usec() >= deadline)
+			break;
+		const PollCompletion &completion = completions[emitted];
+		Dictionary cycle;
+		cycle["seq"] = completion.seq;
+		cycle["start_usec"] = completion.start_usec;
+		cycle["end_usec"] = completion.end_usec;
+		cycle["duration_usec"] = completion.end_usec - completion.start_usec;
+		cycle["tags_read"] = completion.tags_read;
+		cycle["tags_changed"] = completion.tags_changed;
+		cycle["failures"] = completion.failures;
+		emit_signal("tag_group_poll_completed", completion.tag_group_name, cycle);
+
+		// a failed poll says nothing about whether the values are quiet
+		if (completion.tags_changed > 0 || completion.failures == 0)
+			adapt_polling_interval(completion.tag_group_name, completion.tags_changed > 0);
+	}
+
+	if (emitted < completions.size()) {
+		std::lock_guard<std::mutex> lock(poll_completions_mutex);
+		poll_completions.insert(poll_completions.begin(), completions.begin() + emitted, completions.end());
+	}
+	return (int)(completions.size() - emitted);
+}
+
+// adaptive polling: a quiet poll stretches the interval by half, up to the max, a change
+// drops it straight back to the registered interval
+void OIPComms::adapt_polling_interval(const String &tag_group_name, bool changed) {
+	const TagGroupConfig *tag_group_config = find_tag_group_config(tag_group_name);
+	if (tag_group_config == nullptr || tag_group_config->max_polling_interval <= 0)
+		return;
+
+	TagGroupSlot &slot = *tag_group_config->slot;
+	if (changed) {
+		slot.interval = tag_group_config->polling_interval;
+	} else {
+		const int interval = slot.interval;
+		slot.interval = std::min(interval + std::max(interval / 2, 1), tag_group_config->max_polling_interval);
+	}
+}
+
+String OIPComms::plc_tag_path(const TagGroup &tag_group, const String &tag_name, int elem_count) {
+	String group_tag_path = "protocol=" + tag_group.protocol + "&gateway=" + tag_group.gateway + "&path=" + tag_group.path + "&cpu=" + tag_group.cpu + "&elem_count=";
+	return group_tag_path + itos(elem_count) + "&name=" + tag_name;
+}
+
+// plc_tag_create is called with a zero timeout, so every tag starts connecting at once
+// and the pass only takes as long as the slowest device to answer. a tag which fails
+// does not hold up the rest of its group
+void OIPComms::create_plc_tags(const std::vector<String> &tag_group_names) {
+	struct PendingTag {
+		String tag_group_name;
+		String tag_name;
+		int32_t tag_pointer;
+		uint64_t start_usec;
+	};
+	std::vector<PendingTag> pending;
+
+	for (const String &tag_group_name : tag_group_names) {
+		TagGroup &tag_group = tag_groups[tag_group_name];
+		coalesce_plc_tags(tag_group);
+
+		for (auto &x : tag_group.plc_tags) {
+			const String tag_name = x.first;
+			PlcTag &tag = x.second;
+			if (tag.tag_pointer >= 0)
+				continue;
+
+			const String plc_name = tag.name.is_empty() ? tag_name : tag.name;
+			int32_t tag_pointer = plc_tag_create(plc_tag_path(tag_group, plc_name, tag.elem_count).utf8().get_data(), 0);
+			if (tag_pointer < 0) {
+				print_format(OIPLogger::LEVEL_ERROR, "Failed to create tag: {0} ({code})", tag_name, Variant(), Variant(), plc_tag_decode_error(tag_pointer));
+				continue;
+			}
+			pending.push_back({ tag_group_name, tag_name, tag_pointer, Time::get_singleton()->get_ticks_usec() });
+		}
+	}
+
+	if (!pending.empty())
+		print_format(OIPLogger::LEVEL_INFO, "Creating {0} tags", (int64_t)pending.size());
+
+	if (!pending.empty())
+		io_begin(tag_group_names.size() == 1 ? tag_group_names[0] : String(), "", "create");
+
+	OIPCreateBatch batch;
+	for (size_t i = 0; i < pending.size(); i++)
+		batch.add(i, pending[i].tag_pointer);
+
+	std::vector<OIPCreateBatch::Result> finished;
+	uint64_t start_ticks = Time::get_singleton()->get_ticks_msec();
+	while (!batch.empty()) {
+		bool timed_out = Time::get_singleton()->get_ticks_msec() - start_ticks >= (uint64_t)timeout || !work_thread_running;
+
+		finished.clear();
+		batch.poll([](int32_t tag_pointer) { return plc_tag_status(tag_pointer); }, timed_out, finished);
+
+		for (const OIPCreateBatch::Result &result : finished) {
+			const PendingTag &pending_tag = pending[result.id];
+
+			// the tags connect concurrently, so their spans overlap
+			if (profiler.is_enabled())
+				profiler.record("create", pending_tag.tag_group_name + "/" + pending_tag.tag_name, pending_tag.start_usec, Time::get_singleton()->get_ticks_usec(), true);
+
+			TagGroup &tag_group = tag_groups[pending_tag.tag_group_name];
+			if (result.status == PLCTAG_STATUS_OK) {
+				PlcTag &tag = tag_group.plc_tags[pending_tag.tag_name];
+				tag.tag_pointer = result.tag_pointer;
+				tag.elem_size = plc_tag_get_int_attribute(tag.tag_pointer, "elem_size", 0);
+				tag_group.init_count++;
 			} else {
-				// if read was successful, the tag read is now clean
-				tag.dirty = false;
+				plc_tag_destroy(result.tag_pointer);
+				print_format(OIPLogger::LEVEL_ERROR, "Failed to create tag: {0} ({code})", pending_tag.tag_name, Variant(), Variant(), plc_tag_decode_error(result.status));
 			}
 		}
+
+		if (!batch.empty())
+			OS::get_singleton()->delay_msec(1);
+	}
+	io_end();
+
+	for (const String &tag_group_name : tag_group_names) {
+		TagGroup &tag_group = tag_groups[tag_group_name];
+		if (OIPCreateBatch::ready(tag_group.init_count, tag_group.plc_tags.size()))
+			tag_group.slot->ready = true;
 	}
 }
 
-bool OIPComms::init_plc_tag(const String &tag_group_name, const String &tag_name) {
-	TagGroup &tag_group = tag_groups[tag_group_name];
-	PlcTag &tag = tag_group.plc_tags[tag_name];
+static bool oip_split_element(const String &tag_name, String &base, int &index, int &max_span) {
+	std::string plain_base;
+	if (!::oip_split_element(oip_utf8(tag_name), plain_base, index, max_span))
+		return false;
+	base = String::utf8(plain_base.c_str());
+	return true;
+}
 
-	String group_tag_path = "protocol=" + tag_group.protocol + "&gateway=" + tag_group.gateway + "&path=" + tag_group.path + "&cpu=" + tag_group.cpu + "&elem_count=";
+static bool oip_split_bit(const String &tag_name, String &base, int &bit) {
+	std::string plain_base;
+	if (!::oip_split_bit(oip_utf8(tag_name), plain_base, bit))
+		return false;
+	base = String::utf8(plain_base.c_str());
+	return true;
+}
 
-	String tag_path = group_tag_path + itos(tag.elem_count) + "&name=" + tag_name;
-	tag.tag_pointer = plc_tag_create(tag_path.utf8().get_data(), timeout);
+static bool oip_modbus_protocol(const String &protocol) {
+	return protocol == "modbus_tcp" || protocol == "modbus-tcp";
+}
 
-	// failed to create tag
-	if (tag.tag_pointer < 0) {
-		print("Failed to create tag: " + tag_name, true);
-		print("Skipping remainder of tag group: " + tag_group_name);
+static bool oip_modbus_address(const String &tag_name, String &table, int &address) {
+	std::string plain_table;
+	if (!::oip_modbus_address(oip_utf8(tag_name), plain_table, address))
 		return false;
+	table = String::utf8(plain_table.c_str());
+	return true;
+}
+
+// scripts often register every element of an array as its own tag: Data[0], Data[1], ...
+// runs of contiguous elements are folded into one block tag read with elem_count set to
+// the span, and the elements become members served from offsets into the block buffer
+void OIPComms::coalesce_plc_tags(TagGroup &tag_group) {
+	if (oip_modbus_protocol(tag_group.protocol)) {
+		coalesce_modbus_tags(tag_group);
+		return;
 	}
 
-	tag_group.init_count++;
-	return true;
+	struct Element {
+		int index;
+		String tag_name;
+	};
+	std::map<String, std::vector<Element>> arrays;
+	std::map<String, int> max_spans;
+
+	for (auto &x : tag_group.plc_tags) {
+		const PlcTag &tag = x.second;
+		if (tag.tag_pointer >= 0 || tag.elem_count != 1 || !tag.fields.empty() || !tag.members.empty() || !tag.name.is_empty())
+			continue;
+
+		String base;
+		int index, max_span;
+		if (oip_split_element(x.first, base, index, max_span)) {
+			arrays[base].push_back({ index, x.first });
+			max_spans[base] = max_span;
+		}
+	}
+
+	for (auto &x : arrays) {
+		const String &base = x.first;
+		std::vector<Element> &elements = x.second;
+		std::sort(elements.begin(), elements.end(), [](const Element &a, const Element &b) { return a.index < b.index; });
+
+		const String suffix = base.ends_with("[") ? "]" : "";
+		size_t start = 0;
+		while (start < elements.size()) {
+			size_t end = start + 1;
+			while (end < elements.size() && elements[end].index == elements[end - 1].index + 1 && (int)(end - start) < max_spans[base])
+				end++;
+
+			int span = (int)(end - start);
+			if (span > 1) {
+				const int first_index = elements[start].index;
+				const String block_name = base + itos(first_index) + ".." + itos(elements[end - 1].index) + suffix;
+
+				PlcTag block = { false, -1, span, false };
+				block.name = elements[start].tag_name;
+				block.block = true;
+				tag_group.plc_tags[block_name] = block;
+
+				for (size_t i = start; i < end; i++) {
+					const PlcTag &element = tag_group.plc_tags[elements[i].tag_name];
+					PlcMember member = { block_name, 0, -1, -1, elements[i].index - first_index, 0, element.type, element.deadband, element.slot };
+					tag_group.plc_members[elements[i].tag_name] = member;
+					tag_group.plc_tags[block_name].members.push_back(elements[i].tag_name);
+					tag_group.plc_tags.erase(elements[i].tag_name);
+				}
+				print_format(OIPLogger::LEVEL_INFO, "Coalesced {0} elements into block read: {1}", span, block_name);
+			}
+			start = end;
+		}
+	}
+}
+
+// one Modbus request reads at most 125 registers or 2000 coils/discrete inputs. registers
+// of a table are merged into blocks as long as the gap to the next one is small enough
+// that reading the unused addresses in between is cheaper than a separate request
+void OIPComms::coalesce_modbus_tags(TagGroup &tag_group) {
+	struct Address {
+		int address;
+		int count;
+		String tag_name;
+	};
+	std::map<String, std::vector<Address>> tables;
+
+	for (auto &x : tag_group.plc_tags) {
+		PlcTag &tag = x.second;
+		if (tag.tag_pointer >= 0 || !tag.fields.empty() || tag.block)
+			continue;
+
+		String table;
+		int address;
+		if (!oip_modbus_address(x.first, table, address))
+			continue;
+		tables[table].push_back({ address, std::max(tag.elem_count, 1), x.first });
+	}
+
+	for (auto &x : tables) {
+		const String &table = x.first;
+		std::vector<Address> &addresses = x.second;
+		std::sort(addresses.begin(), addresses.end(), [](const Address &a, const Address &b) { return a.address < b.address; });
+
+		const bool bits = table == "co" || table == "di";
+		const int max_span = bits ? 2000 : 125;
+		const int max_gap = bits ? 128 : 16;
+
+		size_t start = 0;
+		while (start < addresses.size()) {
+			const int first = addresses[start].address;
+			int last = first + addresses[start].count - 1;
+			size_t end = start + 1;
+			while (end < addresses.size() && addresses[end].address <= last + 1 + max_gap &&
+					std::max(last, addresses[end].address + addresses[end].count - 1) - first < max_span) {
+				last = std::max(last, addresses[end].address + addresses[end].count - 1);
+				end++;
+			}
+
+			if (end - start == 1) {
+				// a lone address only needs the name libplctag understands
+				tag_group.plc_tags[addresses[start].tag_name].name = table + itos(first);
+			} else {
+				const String block_name = table + itos(first) + ".." + itos(last);
+
+				PlcTag block = { false, -1, last - first + 1, false };
+				block.name = table + itos(first);
+				block.block = true;
+				tag_group.plc_tags[block_name] = block;
+
+				for (size_t i = start; i < end; i++) {
+					const Address &address = addresses[i];
+					const int index = address.address - first;
+					const PlcTag &element = tag_group.plc_tags[address.tag_name];
+					PlcMember member = { block_name, bits ? index / 8 : index * 2, bits ? index % 8 : -1, -1, 0, bits ? 0 : address.count * 2, bits ? -1 : element.type, element.deadband, element.slot };
+					tag_group.plc_members[address.tag_name] = member;
+					tag_group.plc_tags[block_name].members.push_back(address.tag_name);
+					tag_group.plc_tags.erase(address.tag_name);
+				}
+				print_format(OIPLogger::LEVEL_INFO, "Merged {0} Modbus addresses into block read: {1}", (int64_t)(end - start), block_name);
+			}
+			start = end;
+		}
+	}
+}
+
+int OIPComms::plc_member_offset(const PlcTag &owner, const PlcMember &member) {
+	return member.offset + member.elem_index * owner.elem_size;
+}
+
+// hands the main thread what it needs to read a tag and the members served from it.
+// initialized is stored last, a reader which sees it set sees the rest too
+void OIPComms::plc_publish_view(TagGroup &tag_group, PlcTag &tag) {
+	TagSlot *memory_slot = oip_memory_protocol(tag_group.protocol) ? tag.slot.get() : nullptr;
+	auto publish = [&](TagSlot &slot, int offset, int bit) {
+		slot.offset = offset;
+		slot.bit = bit;
+		slot.memory_slot = memory_slot;
+		slot.tag_pointer = tag.tag_pointer;
+		slot.initialized = tag.initialized;
+	};
+
+	if (tag.slot != nullptr)
+		publish(*tag.slot, 0, 0);
+	for (const String &member_name : tag.members) {
+		const PlcMember &member = tag_group.plc_members[member_name];
+		publish(*member.slot, plc_member_offset(tag, member), member.bit >= 0 ? member.bit : 0);
+	}
+}
+
+Variant OIPComms::plc_get_value(int32_t tag_pointer, uint8_t type, int offset, int bit) {
+	switch (type) {
+		case 0:
+			return (bool)plc_tag_get_bit(tag_pointer, offset * 8 + (bit >= 0 ? bit : 0));
+		case 1:
+			return plc_tag_get_uint64(tag_pointer, offset);
+		case 2:
+			return plc_tag_get_int64(tag_pointer, offset);
+		case 3:
+			return plc_tag_get_uint32(tag_pointer, offset);
+		case 4:
+			return plc_tag_get_int32(tag_pointer, offset);
+		case 5:
+			return plc_tag_get_uint16(tag_pointer, offset);
+		case 6:
+			return plc_tag_get_int16(tag_pointer, offset);
+		case 7:
+			return plc_tag_get_uint8(tag_pointer, offset);
+		case 8:
+			return plc_tag_get_int8(tag_pointer, offset);
+		case 9:
+			return plc_tag_get_float64(tag_pointer, offset);
+		case 10:
+			return plc_tag_get_float32(tag_pointer, offset);
+	}
+	return Variant();
 }
 
+// value out of the tag's libplctag buffer or its memory, on the worker
+Variant OIPComms::plc_tag_value(const PlcTag &tag, uint8_t type, int offset, int bit) {
+	if (tag.tag_pointer >= 0 || tag.slot == nullptr)
+		return plc_get_value(tag.tag_pointer, type, offset, bit);
+	return oip_memory_value(tag.slot->memory, type, offset, bit);
+}
+
+// members get their own handle the first time they are written
+int32_t OIPComms::plc_member_write_pointer(TagGroup &tag_group, const String &member_name, PlcMember &member) {
+	if (member.write_pointer < 0) {
+		String plc_name = member_name;
+		int elem_count = 1;
+		String table;
+		int address;
+		if (oip_modbus_protocol(tag_group.protocol) && oip_modbus_address(member_name, table, address)) {
+			plc_name = table + itos(address);
+			if (member.bit < 0)
+				elem_count = std::max(member.size / 2, 1);
+		}
+		member.write_pointer = plc_tag_create(plc_tag_path(tag_group, plc_name, elem_count).utf8().get_data(), timeout);
+		if (member.write_pointer < 0)
+			print_format(OIPLogger::LEVEL_ERROR, "Failed to create tag: {0} ({code})", member_name, Variant(), Variant(), plc_tag_decode_error(member.write_pointer));
+	}
+	return member.write_pointer;
+}
+
+// keep the owning tag's buffer in step with a member write until the next poll refreshes it
+void OIPComms::plc_mirror_member_write(const PlcTag &owner, const PlcMember &member) {
+	if (owner.tag_pointer < 0 || member.write_pointer < 0)
+		return;
+
+	if (member.bit >= 0) {
+		plc_tag_set_bit(owner.tag_pointer, plc_member_offset(owner, member) * 8 + member.bit, plc_tag_get_bit(member.write_pointer, 0));
+		return;
+	}
+
+	uint8_t buffer[8];
+	int size = plc_tag_get_size(member.write_pointer);
+	if (size <= 0 || size > (int)sizeof(buffer))
+		return;
+	if (plc_tag_get_raw_bytes(member.write_pointer, 0, buffer, size) == PLCTAG_STATUS_OK)
+		plc_tag_set_raw_bytes(owner.tag_pointer, plc_member_offset(owner, member), buffer, size);
+}
+
+// the due tags of the group go out in a single read request, which completes in
+// opc_ua_read_callback while the worker carries on with other groups and writes. a group
+// has one read out at a time, polls coming up before it completed are skipped
 void OIPComms::process_opc_ua_tag_group(const String &tag_group_name) {
 	TagGroup &tag_group = tag_groups[tag_group_name];
+	if (tag_group.read_in_flight)
+		return;
+
+	tag_group.poll_seq++;
+	tag_group.poll_tags_read = 0;
+	tag_group.poll_tags_changed = 0;
+	tag_group.poll_failures = 0;
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
 
 	// ensure client is connected
 	if (!opc_ua_client_connected(tag_group_name)) {
 		// if not connected, try to make a new connection
-		if (!init_opc_ua_client(tag_group_name))
+		if (!init_opc_ua_client(tag_group_name)) {
 			// if that fails, give up
+			tag_group.poll_failures++;
+			push_poll_completion(tag_group_name, tag_group, start_usec);
 			return;
+		}
 	}
 
 	for (auto &x : tag_group.opc_ua_tags) {
@@ -319,147 +1896,785 @@ void OIPComms::process_opc_ua_tag_group(const String &tag_group_name) {
 		if (!tag.initialized) {
 			init_opc_ua_tag(tag_group_name, tag_path);
 		}
+	}
 
-		if (tag.initialized) {
-			UA_StatusCode ret_val = UA_Client_readValueAttribute(tag_group.client, tag.node_id, &(tag.value));
-			if (ret_val != UA_STATUSCODE_GOOD) {
-				print("OPC UA failed to read " + tag_path + " with status code " + String(UA_StatusCode_name(ret_val)), true);
-				print("Skipping remainder of tag group: " + tag_group_name);
-				break;
+	// register once per session, before the reads below
+	if (!tag_group.nodes_registered)
+		register_opc_ua_nodes(tag_group_name);
+
+	if (tag_group.init_count >= tag_group.opc_ua_tags.size())
+		tag_group.slot->ready = true;
+
+	const uint64_t now = Time::get_singleton()->get_ticks_usec();
+	OpcUaRead *read = new OpcUaRead{ this, tag_group.gateway, tag_group_name, tag_group.slot, tag_group.poll_seq, {} };
+
+	// the request only borrows the node ids and ranges, it is encoded as it goes out
+	std::vector<UA_ReadValueId> items;
+	for (auto &x : tag_group.opc_ua_tags) {
+		const String tag_path = x.first;
+		OpcUaTag &tag = x.second;
+		if (!tag.initialized)
+			continue;
+
+		// only the worker replaces the value, no lock needed to look at it here
+		const UA_DataType *type = tag.slot->value.type;
+		if (type != nullptr && tag_slot_idle(*tag.slot, now)) {
+			demand_skipped_reads++;
+			demand_skipped_bytes += type->memSize * oip_variant_count(tag.slot->value);
+			continue;
+		}
+
+		demand_reads++;
+		UA_ReadValueId item;
+		UA_ReadValueId_init(&item);
+		item.nodeId = opc_ua_node_id(tag);
+		item.attributeId = UA_ATTRIBUTEID_VALUE;
+		item.indexRange = oip_index_range(tag.index_range);
+		items.push_back(item);
+		read->tag_paths.push_back(tag_path);
+	}
+	if (items.empty()) {
+		delete read;
+		push_poll_completion(tag_group_name, tag_group, start_usec);
+		return;
+	}
+
+	UA_ReadRequest request;
+	UA_ReadRequest_init(&request);
+	request.nodesToRead = items.data();
+	request.nodesToReadSize = items.size();
+	request.timestampsToReturn = UA_TIMESTAMPSTORETURN_BOTH;
+
+	tag_group.read_in_flight = true;
+	tag_group.read_start_usec = start_usec;
+	io_begin(tag_group_name, "", "read");
+	const bool reserved = reserve_opc_ua_request(tag_group.gateway);
+	UA_StatusCode ret_val = reserved ? UA_Client_sendAsyncReadRequest(tag_group.client, &request, opc_ua_read_callback, read, nullptr) : UA_STATUSCODE_BADCONNECTIONCLOSED;
+	io_end();
+	if (ret_val != UA_STATUSCODE_GOOD) {
+		if (reserved)
+			complete_opc_ua_request(tag_group.gateway, tag_group.client);
+		delete read;
+		tag_group.read_in_flight = false;
+		tag_group.poll_failures++;
+		print_format(OIPLogger::LEVEL_ERROR, "OPC UA failed to send the read of tag group {0} with status code {code}", tag_group_name, Variant(), Variant(), UA_StatusCode_name(ret_val));
+		push_poll_completion(tag_group_name, tag_group, start_usec);
+	}
+}
+
+void OIPComms::opc_ua_read_callback(UA_Client *client, void *userdata, UA_UInt32 request_id, UA_ReadResponse *response) {
+	OpcUaRead *read = (OpcUaRead *)userdata;
+	read->comms->complete_opc_ua_read(client, *read, response);
+	delete read;
+}
+
+void OIPComms::complete_opc_ua_read(UA_Client *client, const OpcUaRead &read, UA_ReadResponse *response) {
+	complete_opc_ua_request(read.gateway, client);
+
+	// the group was cleaned up, rebuilt or moved to a new client since the request went out
+	auto tag_group_it = tag_groups.find(read.tag_group_name);
+	if (tag_group_it == tag_groups.end())
+		return;
+	TagGroup &tag_group = tag_group_it->second;
+	if (tag_group.slot != read.slot || tag_group.client != client || !tag_group.read_in_flight || tag_group.poll_seq != read.seq)
+		return;
+
+	tag_group.read_in_flight = false;
+	if (profiler.is_enabled())
+		profiler.record("opc_ua_read", read.tag_group_name, tag_group.read_start_usec, Time::get_singleton()->get_ticks_usec(), true);
+
+	UA_StatusCode ret_val = response->responseHeader.serviceResult;
+	if (ret_val == UA_STATUSCODE_GOOD && response->resultsSize != read.tag_paths.size())
+		ret_val = UA_STATUSCODE_BADUNEXPECTEDERROR;
+	if (ret_val != UA_STATUSCODE_GOOD) {
+		tag_group.poll_failures++;
+		print_format(OIPLogger::LEVEL_ERROR, "OPC UA failed to read tag group {0} with status code {code}", read.tag_group_name, Variant(), Variant(), UA_StatusCode_name(ret_val));
+	} else {
+		PackedStringArray changed;
+		for (size_t i = 0; i < read.tag_paths.size(); i++) {
+			// tags are only ever added to a group, every one of the request is still there
+			const String &tag_path = read.tag_paths[i];
+			if (store_opc_ua_value(read.tag_group_name, tag_group, tag_path, tag_group.opc_ua_tags[tag_path], response->results[i]))
+				changed.push_back(tag_path);
+		}
+		queue_value_changes(read.tag_group_name, changed);
+	}
+
+	push_poll_completion(read.tag_group_name, tag_group, tag_group.read_start_usec);
+}
+
+// takes the value out of one result of a read, true when it changed past the deadband
+bool OIPComms::store_opc_ua_value(const String &tag_group_name, TagGroup &tag_group, const String &tag_path, OpcUaTag &tag, UA_DataValue &result) {
+	UA_StatusCode ret_val = result.hasStatus ? result.status : UA_STATUSCODE_GOOD;
+	if (ret_val == UA_STATUSCODE_GOOD && !result.hasValue)
+		ret_val = UA_STATUSCODE_BADUNEXPECTEDERROR;
+	if (ret_val != UA_STATUSCODE_GOOD) {
+		tag_group.poll_failures++;
+		print_format(OIPLogger::LEVEL_ERROR, "OPC UA failed to read {0} with status code {code}", tag_path, Variant(), Variant(), UA_StatusCode_name(ret_val));
+		return false;
+	}
+
+	// the response is cleared after the callback, the value is taken out of it first
+	UA_Variant value = result.value;
+	UA_Variant_init(&result.value);
+
+	bool changed = false;
+	if (!oip_variant_equal(tag.slot->value, value)) {
+		double number;
+		if (!tag.deadband.enabled() || !oip_variant_to_double(value, number) || tag.deadband.exceeded(number, tag.deadband.reported, tag.deadband.has_reported))
+			changed = true;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(opc_ua_values_mutex);
+		UA_Variant_clear(&tag.slot->value);
+		tag.slot->value = value;
+		tag.slot->source_timestamp = result.hasSourceTimestamp ? result.sourceTimestamp : 0;
+		tag.slot->server_timestamp = result.hasServerTimestamp ? result.serverTimestamp : 0;
+	}
+	tag.slot->cycle_seq = tag_group.poll_seq;
+	tag.slot->received_usec = Time::get_singleton()->get_ticks_usec();
+	tag_group.poll_tags_read++;
+
+	if (recorder.is_recording())
+		record_opc_ua_value(tag_group_name, tag_path, tag);
+	return changed;
+}
+
+// replay groups serve the values of a recorded tag group, following the trace at the
+// speed given in path. tags are matched by name, members recorded out of a block or UDT
+// ("Data[3]", "Motor.Speed") can be registered on their own
+void OIPComms::process_replay_tag_group(const String &tag_group_name) {
+	TagGroup &tag_group = tag_groups[tag_group_name];
+
+	if (tag_group.replay == nullptr) {
+		const String path = ProjectSettings::get_singleton()->globalize_path(tag_group.gateway);
+		const String source_group_name = tag_group.cpu.is_empty() ? tag_group_name : tag_group.cpu;
+
+		// a failed load is kept too, so the error is only printed once per run
+		tag_group.replay = std::make_shared<OIPReplay>();
+		String error;
+		if (!tag_group.replay->load(path, source_group_name, error)) {
+			print_format(OIPLogger::LEVEL_ERROR, "Failed to load trace {0}: {1}", path, error);
+			return;
+		}
+		tag_group.replay->set_speed(tag_group.path.is_empty() ? 1.0 : tag_group.path.to_float());
+		print_format(OIPLogger::LEVEL_INFO, "Replaying {0} polls of {1} for tag group: {2}", (int64_t)tag_group.replay->get_event_count(), source_group_name, tag_group_name);
+
+		OIPReplay::Source source;
+		for (auto &x : tag_group.plc_tags) {
+			if (tag_group.replay->find(x.first, source))
+				tag_group.init_count++;
+			else
+				print_format(OIPLogger::LEVEL_ERROR, "Tag not found in trace: {0}", x.first);
+		}
+		if (tag_group.init_count >= tag_group.plc_tags.size())
+			tag_group.slot->ready = true;
+	}
+
+	OIPReplay &replay = *tag_group.replay;
+	if (!replay.is_loaded()) {
+		tag_group.poll_failures++;
+		return;
+	}
+	replay.advance(Time::get_singleton()->get_ticks_usec());
+
+	PackedStringArray changed;
+	OIPReplay::Source source;
+	for (auto &x : tag_group.plc_tags) {
+		const String tag_name = x.first;
+		PlcTag &tag = x.second;
+
+		if (!replay.find(tag_name, source) || !replay.get_value(source, replay_buffer))
+			continue;
+
+		if (replay_buffer != tag.slot->memory) {
+			std::lock_guard<std::mutex> lock(plc_memory_mutex);
+			tag.slot->memory.swap(replay_buffer);
+		}
+		if (!tag.initialized) {
+			tag.initialized = true;
+			plc_publish_view(tag_group, tag);
+		}
+		plc_stamp(tag_group, tag, Time::get_singleton()->get_ticks_usec());
+		tag_group.poll_tags_read += 1 + (int)tag.members.size();
+		diff_plc_tag(tag_group_name, tag_group, tag_name, tag, changed);
+	}
+	queue_value_changes(tag_group_name, changed);
+}
+
+// sim groups stand in for a device kept in memory: gateway is the latency of a request in
+// ms, path the jitter added on top of it and cpu the percentage of requests which fail.
+// a poll is one request for the whole group, which copies the device values into the
+// tags the same way a PLC read fills their buffers. like an OPC UA read it completes
+// asynchronously, once its latency passed, and further polls are skipped until then
+void OIPComms::process_sim_tag_group(const String &tag_group_name) {
+	TagGroup &tag_group = tag_groups[tag_group_name];
+	if (tag_group.read_in_flight)
+		return;
+
+	tag_group.poll_seq++;
+	tag_group.poll_tags_read = 0;
+	tag_group.poll_tags_changed = 0;
+	tag_group.poll_failures = 0;
+
+	if (tag_group.init_count < tag_group.plc_tags.size()) {
+		for (auto &x : tag_group.plc_tags) {
+			PlcTag &tag = x.second;
+			if (tag.initialized)
+				continue;
+
+			// plain tags don't carry a type, every element gets room for the largest one
+			int size = tag.elem_count * 8;
+			for (const PlcField &field : tag.fields) {
+				size = std::max(size, field.offset + (field.type == 0 ? std::max(field.bit, 0) / 8 + 1 : oip_type_size(field.type)));
+			}
+			tag.elem_size = 8;
+			tag_group.sim_values[x.first].assign(size, 0);
+			tag.initialized = true;
+			tag_group.init_count++;
+			plc_publish_view(tag_group, tag);
+		}
+		tag_group.slot->ready = true;
+	}
+
+	tag_group.read_in_flight = true;
+	tag_group.read_start_usec = Time::get_singleton()->get_ticks_usec();
+	queue_sim_request(tag_group, { tag_group_name, tag_group.slot, true, tag_group.poll_seq, WriteRequest() });
+}
+
+// writes land on the device values once their latency passed, the tags pick them up on the
+// next poll which completes after them
+void OIPComms::process_sim_write(const WriteRequest &write_req) {
+	TagGroup &tag_group = tag_groups[write_req.tag_group_name];
+	queue_sim_request(tag_group, { write_req.tag_group_name, tag_group.slot, false, 0, write_req });
+}
+
+// the requests of a group complete in the order they were sent, each one its latency
+// after the one before or after being sent, whichever is later
+void OIPComms::queue_sim_request(TagGroup &tag_group, const SimRequest &request) {
+	double latency = tag_group.gateway.to_float();
+	double jitter = tag_group.path.to_float();
+	if (jitter > 0.0)
+		latency += std::uniform_real_distribution<double>(0.0, jitter)(sim_random);
+
+	const uint64_t now = Time::get_singleton()->get_ticks_usec();
+	const uint64_t due_usec = std::max(now, tag_group.sim_busy_usec) + (uint64_t)std::max(latency * 1000.0, 0.0);
+	tag_group.sim_busy_usec = due_usec;
+	sim_requests.emplace(due_usec, request);
+}
+
+// requests which are due, in the order they came due
+void OIPComms::complete_sim_requests() {
+	const uint64_t now = Time::get_singleton()->get_ticks_usec();
+	while (!sim_requests.empty() && sim_requests.begin()->first <= now) {
+		const SimRequest request = sim_requests.begin()->second;
+		sim_requests.erase(sim_requests.begin());
+
+		// the group was cleaned up or rebuilt since the request was sent
+		auto tag_group_it = tag_groups.find(request.tag_group_name);
+		if (tag_group_it == tag_groups.end() || tag_group_it->second.slot != request.slot)
+			continue;
+
+		if (request.read)
+			complete_sim_read(request);
+		else
+			complete_sim_write(request.write_req);
+	}
+}
+
+void OIPComms::complete_sim_read(const SimRequest &request) {
+	TagGroup &tag_group = tag_groups[request.tag_group_name];
+	if (!tag_group.read_in_flight || tag_group.poll_seq != request.seq)
+		return;
+
+	tag_group.read_in_flight = false;
+	if (profiler.is_enabled())
+		profiler.record("sim_read", request.tag_group_name, tag_group.read_start_usec, Time::get_singleton()->get_ticks_usec(), true);
+
+	if (sim_failed(tag_group)) {
+		tag_group.poll_failures++;
+		print_format(OIPLogger::LEVEL_ERROR, "Failed to read tag group: {0}", request.tag_group_name);
+	} else {
+		PackedStringArray changed;
+		for (auto &x : tag_group.plc_tags) {
+			const String tag_name = x.first;
+			PlcTag &tag = x.second;
+
+			const std::vector<uint8_t> &values = tag_group.sim_values[tag_name];
+			if (values != tag.slot->memory) {
+				std::lock_guard<std::mutex> lock(plc_memory_mutex);
+				tag.slot->memory = values;
 			}
+			plc_stamp(tag_group, tag, Time::get_singleton()->get_ticks_usec());
+			tag_group.poll_tags_read += 1 + (int)tag.members.size();
+			diff_plc_tag(request.tag_group_name, tag_group, tag_name, tag, changed);
 		}
+		queue_value_changes(request.tag_group_name, changed);
+	}
+
+	push_poll_completion(request.tag_group_name, tag_group, tag_group.read_start_usec);
+}
+
+void OIPComms::complete_sim_write(const WriteRequest &write_req) {
+	TagGroup &tag_group = tag_groups[write_req.tag_group_name];
+
+	String tag_name = write_req.tag_name;
+	int offset = 0;
+	int bit = 0;
+	auto member_it = tag_group.plc_members.find(write_req.tag_name);
+	if (member_it != tag_group.plc_members.end()) {
+		const PlcMember &member = member_it->second;
+		tag_name = member.tag_name;
+		offset = plc_member_offset(tag_group.plc_tags[tag_name], member);
+		bit = std::max(member.bit, 0);
+	}
+
+	uint8_t bytes[8];
+	size_t size = oip_encode_value(write_req.value, write_req.instruction, bytes);
+	std::vector<uint8_t> &values = tag_group.sim_values[tag_name];
+	if (size == 0 || sim_failed(tag_group) || offset + size > values.size()) {
+		print_format(OIPLogger::LEVEL_ERROR, "Failed to write tag: {0}", write_req.tag_name);
+		return;
+	}
+
+	if (write_req.instruction == 0) {
+		uint8_t mask = 1 << (bit % 8);
+		uint8_t &byte = values[offset + bit / 8];
+		byte = bytes[0] ? (byte | mask) : (byte & ~mask);
+	} else {
+		memcpy(values.data() + offset, bytes, size);
 	}
+	tag_group.plc_tags[tag_name].dirty = true;
+}
+
+bool OIPComms::sim_failed(const TagGroup &tag_group) {
+	double failure_rate = tag_group.cpu.to_float() / 100.0;
+	return failure_rate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(sim_random) < failure_rate;
+}
+
+// groups on the same endpoint share its client. a client found disconnected is replaced,
+// which takes every group on it to the new session
+bool OIPComms::init_opc_ua_client(const String& tag_group_name) {
+	TagGroup &tag_group = tag_groups[tag_group_name];
+	OpcUaClient &shared = opc_ua_clients[tag_group.gateway];
+
+	UA_StatusCode ret_val = UA_STATUSCODE_BAD;
+
+	if (shared.client != nullptr) {
+		UA_StatusCode client_status;
+		UA_Client_getState(shared.client, nullptr, nullptr, &client_status);
+		if (client_status != UA_STATUSCODE_GOOD) {
+			// the reads still out on the client are failed here. the groups let go of it first,
+			// so the BadShutdown completions fired by UA_Client_delete are dropped as stale
+			UA_Client *dead = shared.client;
+			for (auto &x : tag_groups) {
+				TagGroup &other = x.second;
+				if (other.client != dead)
+					continue;
+				other.client = nullptr;
+				if (other.read_in_flight) {
+					other.read_in_flight = false;
+					other.poll_failures++;
+					print_format(OIPLogger::LEVEL_ERROR, "OPC UA read of tag group {0} lost with the connection", x.first);
+					push_poll_completion(x.first, other, other.read_start_usec);
+				}
+			}
+			shared.client = nullptr;
+			shared.requests_in_flight = 0;
+			UA_Client_delete(dead);
+		}
+	}
+
+	if (shared.client == nullptr) {
+		shared.client = UA_Client_new();
+		if (shared.writes.empty())
+			shared.writes.resize(OPC_UA_MAX_IN_FLIGHT);
+
+		// the session serves every group on the endpoint, it waits as long as the most patient
+		int timeout = 0;
+		for (auto const &x : tag_groups) {
+			if (x.second.protocol == "opc_ua" && x.second.gateway == tag_group.gateway)
+				timeout = std::max(timeout, x.second.timeout);
+		}
+
+		UA_ClientConfig *config = UA_Client_getConfig(shared.client);
+		UA_ClientConfig_setDefault(config);
+		if (timeout > 0)
+			config->timeout = timeout;
+		//config->logging = nullptr;
+
+		const CharString endpoint_URL = tag_group.gateway.utf8();
+		io_begin(tag_group_name, "", "connect");
+		ret_val = UA_Client_connect(shared.client, endpoint_URL.get_data());
+		io_end();
+		if (ret_val != UA_STATUSCODE_GOOD) {
+			UA_Client_delete(shared.client);
+			shared.client = nullptr;
+			print_format(OIPLogger::LEVEL_ERROR, "OIP Comms: The OPC UA connection failed with status code {code}", Variant(), Variant(), Variant(), UA_StatusCode_name(ret_val));
+			return false;
+		}
+		shared.session++;
+	}
+	tag_group.client = shared.client;
+
+	// registered node ids die with the old session
+	if (tag_group.opc_ua_session != shared.session) {
+		for (auto &x : tag_group.opc_ua_tags) {
+			UA_NodeId_clear(&x.second.registered_node_id);
+		}
+		tag_group.nodes_registered = false;
+		tag_group.opc_ua_session = shared.session;
+	}
+
+	return true;
+}
+
+bool OIPComms::init_opc_ua_tag(const String &tag_group_name, const String &tag_path) {
+	TagGroup &tag_group = tag_groups[tag_group_name];
+	OpcUaTag &tag = tag_group.opc_ua_tags[tag_path];
+
+	// parsed when the tag was registered
+	UA_NodeId_copy(&tag.slot->node_id, &tag.node_id);
+	tag.initialized = true;
+	tag.slot->initialized = true;
+
+	tag_group.init_count++;
+	tag_group.nodes_registered = false;
+
+	return true;
+}
+
+// the RegisterNodes service lets the server hand back ids which are cheaper to resolve
+// than the string ids the tags are created with. all unregistered tags of the group go
+// out in a single request. servers which don't support it keep using the original ids
+void OIPComms::register_opc_ua_nodes(const String &tag_group_name) {
+	TagGroup &tag_group = tag_groups[tag_group_name];
+	tag_group.nodes_registered = true;
+
+	std::vector<OpcUaTag *> tags;
+	std::vector<UA_NodeId> node_ids;
+	for (auto &x : tag_group.opc_ua_tags) {
+		OpcUaTag &tag = x.second;
+		if (tag.initialized && UA_NodeId_isNull(&tag.registered_node_id)) {
+			tags.push_back(&tag);
+			node_ids.push_back(tag.node_id);
+		}
+	}
+	if (tags.empty())
+		return;
+
+	// the request only borrows the node ids, so it is not cleared
+	UA_RegisterNodesRequest request;
+	UA_RegisterNodesRequest_init(&request);
+	request.nodesToRegisterSize = node_ids.size();
+	request.nodesToRegister = node_ids.data();
+
+	io_begin(tag_group_name, "", "register");
+	UA_RegisterNodesResponse response = UA_Client_Service_registerNodes(tag_group.client, request);
+	io_end();
+	UA_StatusCode ret_val = response.responseHeader.serviceResult;
+	if (ret_val == UA_STATUSCODE_GOOD && response.registeredNodeIdsSize == tags.size()) {
+		for (size_t i = 0; i < tags.size(); i++) {
+			UA_NodeId_copy(&response.registeredNodeIds[i], &tags[i]->registered_node_id);
+		}
+		print_format(OIPLogger::LEVEL_INFO, "Registered {0} nodes for tag group: {1}", (int64_t)tags.size(), tag_group_name);
+	} else {
+		print_format(OIPLogger::LEVEL_WARNING, "OPC UA RegisterNodes not available for tag group {0} ({code}), using the original node ids", tag_group_name, Variant(), Variant(), UA_StatusCode_name(ret_val));
+	}
+	UA_RegisterNodesResponse_clear(&response);
+}
+
+const UA_NodeId &OIPComms::opc_ua_node_id(const OpcUaTag &tag) {
+	if (UA_NodeId_isNull(&tag.registered_node_id))
+		return tag.node_id;
+	return tag.registered_node_id;
 }
 
-bool OIPComms::init_opc_ua_client(const String& tag_group_name) {
+bool OIPComms::opc_ua_client_connected(const String &tag_group_name) {
 	TagGroup &tag_group = tag_groups[tag_group_name];
+	if (tag_group.client == nullptr)
+		return false;
 
-	UA_StatusCode ret_val = UA_STATUSCODE_BAD;
+	UA_StatusCode client_status;
+	UA_Client_getState(tag_group.client, nullptr, nullptr, &client_status);
+	if (client_status != UA_STATUSCODE_GOOD)
+		return false;
+	return true;
+}
 
-	tag_group.client = UA_Client_new();
+// deletes the client of an endpoint once no group is on it anymore
+void OIPComms::release_opc_ua_client(const String &gateway) {
+	auto client_it = opc_ua_clients.find(gateway);
+	if (client_it == opc_ua_clients.end())
+		return;
+
+	for (auto const &x : tag_groups) {
+		if (x.second.client != nullptr && x.second.client == client_it->second.client)
+			return;
+	}
 
-	UA_ClientConfig *config = UA_Client_getConfig(tag_group.client);
-	UA_ClientConfig_setDefault(config);
-	//config->logging = nullptr;
+	// requests still out complete as stale while the client is deleted
+	if (client_it->second.client != nullptr)
+		UA_Client_delete(client_it->second.client);
+	opc_ua_clients.erase(client_it);
+}
 
-	const char *endpoint_URL = tag_group.gateway.utf8().get_data();
-	ret_val = UA_Client_connect(tag_group.client, endpoint_URL);
-	if (ret_val != UA_STATUSCODE_GOOD) {
-		print("OIP Comms: The OPC UA connection failed with status code " + String(UA_StatusCode_name(ret_val)), true);
-		return false;
+// takes one of the requests a client may have out, waiting for completions while it is at
+// the limit. false when the client failed while waiting
+bool OIPComms::reserve_opc_ua_request(const String &gateway) {
+	OpcUaClient &shared = opc_ua_clients[gateway];
+	while (shared.client != nullptr && shared.requests_in_flight >= OPC_UA_MAX_IN_FLIGHT) {
+		if (UA_Client_run_iterate(shared.client, 10) != UA_STATUSCODE_GOOD)
+			return false;
 	}
+	if (shared.client == nullptr)
+		return false;
 
+	shared.requests_in_flight++;
 	return true;
 }
 
-bool OIPComms::init_opc_ua_tag(const String &tag_group_name, const String &tag_path) {
-	TagGroup &tag_group = tag_groups[tag_group_name];
-	OpcUaTag &tag = tag_group.opc_ua_tags[tag_path];
+void OIPComms::complete_opc_ua_request(const String &gateway, UA_Client *client) {
+	auto client_it = opc_ua_clients.find(gateway);
+	if (client_it != opc_ua_clients.end() && client_it->second.client == client && client_it->second.requests_in_flight > 0)
+		client_it->second.requests_in_flight--;
+}
 
-	UA_Variant_init(&tag.value);
+int OIPComms::opc_ua_requests_in_flight() {
+	int count = 0;
+	for (auto const &x : opc_ua_clients) {
+		count += x.second.requests_in_flight;
+	}
+	return count;
+}
 
-	tag.node_id = UA_NODEID_STRING_ALLOC((UA_UInt16)tag_group.path.to_int(), tag_path.utf8().get_data());
-	tag.initialized = true;
+// completions arrive, and the sessions are kept up, in UA_Client_run_iterate. it takes
+// what the sockets have without waiting, the worker does its waiting on the queue
+void OIPComms::iterate_opc_ua_clients() {
+	for (auto const &x : opc_ua_clients) {
+		const OpcUaClient &shared = x.second;
+		if (shared.client != nullptr)
+			UA_Client_run_iterate(shared.client, 0);
+	}
+}
 
-	tag_group.init_count++;
+// the tag and every member served from its buffer got their value in the current poll
+void OIPComms::plc_stamp(TagGroup &tag_group, PlcTag &tag, uint64_t received_usec) {
+	auto stamp = [&](TagSlot &slot) {
+		slot.cycle_seq = tag_group.poll_seq;
+		slot.received_usec = received_usec;
+	};
 
-	return true;
+	if (tag.slot != nullptr)
+		stamp(*tag.slot);
+	for (const String &member_name : tag.members) {
+		stamp(*tag_group.plc_members[member_name].slot);
+	}
 }
 
-bool OIPComms::opc_ua_client_connected(const String &tag_group_name) {
-	TagGroup &tag_group = tag_groups[tag_group_name];
-	if (tag_group.client == nullptr)
+bool OIPComms::tag_slot_idle(const TagSlot &slot, uint64_t now) {
+	const int window = demand_window;
+	if (window <= 0)
 		return false;
 
-	UA_StatusCode client_status;
-	UA_Client_getState(tag_group.client, nullptr, nullptr, &client_status);
-	if (client_status != UA_STATUSCODE_GOOD)
+	// a read_* on the main thread may have stamped the tag after now was taken
+	const uint64_t last_access = slot.last_access;
+	return last_access < now && now - last_access > (uint64_t)window * 1000;
+}
+
+// a tag is only read for as long as a script reads it or one of the members served from it.
+// tags are always read until they have a value
+bool OIPComms::plc_tag_idle(TagGroup &tag_group, const PlcTag &tag, uint64_t now) {
+	if (demand_window <= 0 || !tag.initialized)
+		return false;
+
+	if (tag.slot != nullptr && !tag_slot_idle(*tag.slot, now))
 		return false;
+	for (const String &member_name : tag.members) {
+		if (!tag_slot_idle(*tag_group.plc_members[member_name].slot, now))
+			return false;
+	}
 	return true;
 }
 
-bool OIPComms::tag_group_exists(const String& tag_group_name) {
-	return tag_groups.find(tag_group_name) != tag_groups.end();
-}
+// called by the read_* methods. the first read of a tag left out of the polls fetches its
+// group right away, the value arrives with the next tag_group_poll_completed
+void OIPComms::touch_tag(const String &tag_group_name, const TagGroupConfig &tag_group_config, TagSlot &slot) {
+	const uint64_t now = Time::get_singleton()->get_ticks_usec();
+	const uint64_t last_access = slot.last_access.exchange(now);
+	const int window = demand_window;
+	if (window <= 0 || now - last_access <= (uint64_t)window * 1000 || !slot.initialized)
+		return;
 
-bool OIPComms::tag_exists(const String& tag_group_name, const String& tag_name) {
-	if (tag_group_exists(tag_group_name)) {
-		TagGroup &tag_group = tag_groups[tag_group_name];
-		if (tag_group.protocol == "opc_ua") {
-			return tag_group.opc_ua_tags.find(tag_name) != tag_group.opc_ua_tags.end();
-		} else {
-			return tag_group.plc_tags.find(tag_name) != tag_group.plc_tags.end();
-		}
+	TagGroupSlot &tag_group = *tag_group_config.slot;
+	if (tag_group.demand_fetch_ticks != last_ticks) {
+		tag_group.demand_fetch_ticks = last_ticks;
+		queue_tag_group(tag_group_name);
 	}
-	return false;
 }
 
-bool OIPComms::process_plc_read(PlcTag &tag, const String &tag_name) {
-	int read_result = plc_tag_read(tag.tag_pointer, timeout);
+bool OIPComms::process_plc_read(const String &tag_group_name, TagGroup &tag_group, PlcTag &tag, const String &tag_name) {
+	demand_reads++;
+	io_begin(tag_group_name, tag_name, "read", tag.tag_pointer);
+	const uint64_t start_usec = Time::get_singleton()->get_ticks_usec();
+	int read_result = plc_tag_read(tag.tag_pointer, plc_timeout(tag_group));
+	plc_rtt_sample(tag_group, start_usec, read_result);
+	io_end();
 	if (read_result != PLCTAG_STATUS_OK) {
-		print("Failed to read tag: " + tag_name, true);
+		print_format(OIPLogger::LEVEL_ERROR, "Failed to read tag: {0}", tag_name);
 		return false;
 	}
-	if (!tag.initialized)
+	plc_stamp(tag_group, tag, Time::get_singleton()->get_ticks_usec());
+	if (!tag.initialized) {
 		tag.initialized = true;
+		plc_publish_view(tag_group, tag);
+	}
 
 	return true;
 }
 
+// tags are still created with the full timeout, the first connection to a device takes
+// much longer than the requests after it
+int OIPComms::plc_timeout(const TagGroup &tag_group) {
+	if (tag_group.timeout > 0)
+		return tag_group.timeout;
+
+	std::lock_guard<std::mutex> lock(gateway_rtts_mutex);
+	auto rtt_it = gateway_rtts.find(tag_group.gateway);
+	return rtt_it != gateway_rtts.end() ? rtt_it->second.timeout(timeout) : timeout;
+}
+
+// only answered calls are a round trip, a timeout backs the gateway off instead
+void OIPComms::plc_rtt_sample(const TagGroup &tag_group, uint64_t start_usec, int status) {
+	std::lock_guard<std::mutex> lock(gateway_rtts_mutex);
+	GatewayRtt &rtt = gateway_rtts[tag_group.gateway];
+	if (status == PLCTAG_ERR_TIMEOUT) {
+		rtt.back_off();
+	} else if (status == PLCTAG_STATUS_OK) {
+		rtt.sample((Time::get_singleton()->get_ticks_usec() - start_usec) / 1000.0);
+	}
+}
+
 void OIPComms::process() {
-	if (enable_comms && sim_running) {
-		uint64_t current_ticks = Time::get_singleton()->get_ticks_usec();
+	OIPProfiler::Scope span(profiler, "process");
+	uint64_t current_ticks = Time::get_singleton()->get_ticks_usec();
+	flush_log();
+
+	// the recorder stops on its own when the trace file cannot be extended, e.g. a full disk
+	if (recorder.has_failed()) {
+		recorder.stop();
+		print("Recording stopped, writing the trace file failed: " + itos(recorder.get_records()) + " records written, " + itos(recorder.get_dropped()) + " dropped", true);
+	}
+
+	if (enable_comms.load() && sim_running.load()) {
+		// registrations of the last frame go out before the groups get queued
+		publish_config();
+
+		const uint64_t deadline = frame_budget_usec > 0 ? current_ticks + frame_budget_usec : 0;
 		double delta = (current_ticks - last_ticks) / 1000.0f;
-		for (auto &x : tag_groups) {
+
+		// on the fixed clock the groups were already queued by the tick thread
+		const bool fixed = fixed_clock;
+		if (fixed) {
+			update_tick_schedule();
+			std::vector<String> polled;
+			{
+				std::lock_guard<std::mutex> lock(tick_mutex);
+				polled.swap(tick_polled);
+			}
+			for (const String &tag_group_name : polled) {
+				emit_signal("tag_group_polled", tag_group_name);
+			}
+		}
+
+		for (auto &x : config_draft->tag_groups) {
 			const String tag_group_name = x.first;
-			TagGroup &tag_group = x.second;
+			const TagGroupConfig &tag_group_config = *x.second;
+			TagGroupSlot &tag_group = *tag_group_config.slot;
 
 			tag_group.time += delta;
 			
-			if (tag_group.time >= tag_group.polling_interval) {
+			if (!fixed && tag_group.time >= tag_group.interval) {
 				queue_tag_group(tag_group_name);
 				emit_signal("tag_group_polled", tag_group_name);
 				tag_group.time = 0.0f;
 			}
 
-			// check for tag initialization after 500 ms
-			// TBD -> there might be a better solution - not sure yet
-			if (startup_timer >= register_wait_time && !tag_group.init_count_emitted) {
-				size_t total_tag_count = 0;
-				if (tag_group.protocol == "opc_ua")
-					total_tag_count = tag_group.opc_ua_tags.size();
-				else
-					total_tag_count = tag_group.plc_tags.size();
-
-				if (tag_group.init_count >= total_tag_count) {
-					emit_signal("tag_group_initialized", tag_group_name);
-					print("Tag group initialized: " + tag_group_name);
-					tag_group.init_count_emitted = true;
-				}
+			// the worker flags a group as ready once all of its tags have been created
+			if (!tag_group.ready) {
+				tag_group.init_count_emitted = false;
+			} else if (!tag_group.init_count_emitted) {
+				emit_signal("tag_group_initialized", tag_group_name);
+				print("Tag group initialized: " + tag_group_name);
+				tag_group.init_count_emitted = true;
 			}
 		}
-		if (startup_timer <= register_wait_time + 500.0f)
-			startup_timer += delta;
+
+		frame_deferred = emit_value_changes(deadline);
+		frame_deferred += emit_poll_completions(deadline);
+		emit_stalls();
 
 		last_ticks = current_ticks;
-	} else {
-		startup_timer = 0.0f;
+
+		frame_usec = Time::get_singleton()->get_ticks_usec() - current_ticks;
+		frame_average_usec += (frame_usec - frame_average_usec) * 0.05;
+		frame_max_usec = std::max(frame_max_usec, frame_usec);
 	}
 }
 
 void OIPComms::print(const Variant &message, bool error) {
-	if (error) {
-		// always print errors
-		UtilityFunctions::printerr("OIPComms: " + String(message));
-		if (!comms_error) {
-			emit_signal("comms_error");
-			last_error = message;
-			comms_error = true;
-		}
-	} else {
-		if (enable_log) {
-			// only print non-errors if enable_log is on
-			UtilityFunctions::print("OIPComms: " + String(message));
+	print(message, error ? OIPLogger::LEVEL_ERROR : OIPLogger::LEVEL_INFO);
+}
+
+void OIPComms::print_format(OIPLogger::Level level, const char *format, const Variant &arg0, const Variant &arg1, const Variant &arg2, const char *code) {
+	if (level == OIPLogger::LEVEL_INFO && !enable_log)
+		return;
+
+	logger.push(level, format, arg0, arg1, arg2, code);
+	if (std::this_thread::get_id() == main_thread_id)
+		flush_log();
+}
+
+// safe from any thread: the message is only queued, the main thread prints it on its next
+// frame, or right away when it is the one logging
+void OIPComms::print(const Variant &message, OIPLogger::Level level) {
+	// only print non-errors if enable_log is on
+	if (level == OIPLogger::LEVEL_INFO && !enable_log)
+		return;
+
+	logger.push(level, message);
+	if (std::this_thread::get_id() == main_thread_id)
+		flush_log();
+}
+
+void OIPComms::flush_log() {
+	std::vector<OIPLogger::Entry> entries;
+	logger.drain(Time::get_singleton()->get_ticks_usec(), entries);
+
+	const uint64_t dropped = logger.get_dropped();
+	if (dropped != logged_drops) {
+		entries.push_back({ OIPLogger::LEVEL_WARNING, itos(dropped - logged_drops) + " log messages dropped" });
+		logged_drops = dropped;
+	}
+
+	for (const OIPLogger::Entry &entry : entries) {
+		switch (entry.level) {
+			case OIPLogger::LEVEL_ERROR:
+				// always print errors
+				UtilityFunctions::printerr("OIPComms: " + entry.message);
+				if (!comms_error) {
+					emit_signal("comms_error");
+					last_error = entry.message;
+					comms_error = true;
+				}
+				break;
+			case OIPLogger::LEVEL_WARNING:
+				UtilityFunctions::push_warning("OIPComms: " + entry.message);
+				break;
+			default:
+				UtilityFunctions::print("OIPComms: " + entry.message);
+				break;
 		}
 	}
 }
@@ -467,8 +2682,11 @@ void OIPComms::print(const Variant &message, bool error) {
 // --- GDSCRIPT BOUND FUNCTIONS
 
 void OIPComms::_bind_methods() {
-	ClassDB::bind_method(D_METHOD("register_tag_group", "tag_group_name", "polling_interval", "protocol", "gateway", "path", "cpu"), &OIPComms::register_tag_group);
-	ClassDB::bind_method(D_METHOD("register_tag", "tag_group_name", "tag_name", "elem_count"), &OIPComms::register_tag);
+	ClassDB::bind_method(D_METHOD("register_tag_group", "tag_group_name", "polling_interval", "protocol", "gateway", "path", "cpu", "timeout"), &OIPComms::register_tag_group, DEFVAL(0));
+	ClassDB::bind_method(D_METHOD("register_tag", "tag_group_name", "tag_name", "elem_count", "deadband", "deadband_percent", "type"), &OIPComms::register_tag, DEFVAL(0.0), DEFVAL(0.0), DEFVAL(""));
+	ClassDB::bind_method(D_METHOD("register_udt_tag", "tag_group_name", "tag_name", "fields"), &OIPComms::register_udt_tag);
+	ClassDB::bind_method(D_METHOD("register_bit_field", "tag_group_name", "tag_name", "elem_count"), &OIPComms::register_bit_field);
+	ClassDB::bind_method(D_METHOD("register_array_tag", "tag_group_name", "tag_name", "index_range"), &OIPComms::register_array_tag, DEFVAL(""));
 
 	ClassDB::bind_method(D_METHOD("set_enable_comms", "value"), &OIPComms::set_enable_comms);
 	ClassDB::bind_method(D_METHOD("get_enable_comms"), &OIPComms::get_enable_comms);
@@ -480,6 +2698,30 @@ void OIPComms::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_enable_log"), &OIPComms::get_enable_log);
 
 	ClassDB::bind_method(D_METHOD("get_comms_error"), &OIPComms::get_comms_error);
+	ClassDB::bind_method(D_METHOD("get_gateway_stats"), &OIPComms::get_gateway_stats);
+
+	ClassDB::bind_method(D_METHOD("get_tag_age_usec", "tag_group_name", "tag_name"), &OIPComms::get_tag_age_usec);
+	ClassDB::bind_method(D_METHOD("get_tag_timestamps", "tag_group_name", "tag_name"), &OIPComms::get_tag_timestamps);
+
+	ClassDB::bind_method(D_METHOD("set_demand_polling", "window"), &OIPComms::set_demand_polling);
+	ClassDB::bind_method(D_METHOD("get_demand_polling"), &OIPComms::get_demand_polling);
+	ClassDB::bind_method(D_METHOD("get_demand_polling_stats"), &OIPComms::get_demand_polling_stats);
+
+	ClassDB::bind_method(D_METHOD("set_adaptive_polling", "tag_group_name", "max_polling_interval"), &OIPComms::set_adaptive_polling);
+	ClassDB::bind_method(D_METHOD("get_polling_interval", "tag_group_name"), &OIPComms::get_polling_interval);
+
+	ClassDB::bind_method(D_METHOD("set_stall_threshold", "threshold"), &OIPComms::set_stall_threshold);
+	ClassDB::bind_method(D_METHOD("get_stall_threshold"), &OIPComms::get_stall_threshold);
+	ClassDB::bind_method(D_METHOD("set_abort_stalled", "abort"), &OIPComms::set_abort_stalled);
+	ClassDB::bind_method(D_METHOD("get_abort_stalled"), &OIPComms::get_abort_stalled);
+
+	ClassDB::bind_method(D_METHOD("set_process_clock", "clock"), &OIPComms::set_process_clock);
+	ClassDB::bind_method(D_METHOD("get_process_clock"), &OIPComms::get_process_clock);
+	ClassDB::bind_method(D_METHOD("set_fixed_tick_rate", "rate"), &OIPComms::set_fixed_tick_rate);
+	ClassDB::bind_method(D_METHOD("get_fixed_tick_rate"), &OIPComms::get_fixed_tick_rate);
+	ClassDB::bind_method(D_METHOD("set_frame_budget_usec", "budget"), &OIPComms::set_frame_budget_usec);
+	ClassDB::bind_method(D_METHOD("get_frame_budget_usec"), &OIPComms::get_frame_budget_usec);
+	ClassDB::bind_method(D_METHOD("get_main_thread_stats"), &OIPComms::get_main_thread_stats);
 
 	ClassDB::bind_method(D_METHOD("read_bit", "tag_group_name", "tag_name"), &OIPComms::read_bit);
 	ClassDB::bind_method(D_METHOD("read_uint64", "tag_group_name", "tag_name"), &OIPComms::read_uint64);
@@ -505,69 +2747,175 @@ void OIPComms::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("write_float64", "tag_group_name", "tag_name", "value"), &OIPComms::write_float64);
 	ClassDB::bind_method(D_METHOD("write_float32", "tag_group_name", "tag_name", "value"), &OIPComms::write_float32);
 
+	ClassDB::bind_method(D_METHOD("read_bits", "tag_group_name", "tag_name"), &OIPComms::read_bits);
+	ClassDB::bind_method(D_METHOD("read_array", "tag_group_name", "tag_name"), &OIPComms::read_array);
+	ClassDB::bind_method(D_METHOD("get_array_dimensions", "tag_group_name", "tag_name"), &OIPComms::get_array_dimensions);
+	ClassDB::bind_method(D_METHOD("write_array", "tag_group_name", "tag_name", "value", "index_range"), &OIPComms::write_array, DEFVAL(""));
+	ClassDB::bind_method(D_METHOD("read_udt", "tag_group_name", "tag_name"), &OIPComms::read_udt);
+
 	ClassDB::bind_method(D_METHOD("get_tag_groups"), &OIPComms::get_tag_groups);
 
 	ClassDB::bind_method(D_METHOD("clear_tag_groups"), &OIPComms::clear_tag_groups);
 
+	ClassDB::bind_method(D_METHOD("start_recording", "path"), &OIPComms::start_recording);
+	ClassDB::bind_method(D_METHOD("stop_recording"), &OIPComms::stop_recording);
+	ClassDB::bind_method(D_METHOD("get_recording_stats"), &OIPComms::get_recording_stats);
+
+	ClassDB::bind_method(D_METHOD("set_enable_profiling", "value"), &OIPComms::set_enable_profiling);
+	ClassDB::bind_method(D_METHOD("get_enable_profiling"), &OIPComms::get_enable_profiling);
+	ClassDB::bind_method(D_METHOD("dump_profile", "path"), &OIPComms::dump_profile);
+
 	ADD_SIGNAL(MethodInfo("tag_group_polled", PropertyInfo(Variant::STRING, "tag_group_name")));
+	ADD_SIGNAL(MethodInfo("tag_group_poll_completed", PropertyInfo(Variant::STRING, "tag_group_name"), PropertyInfo(Variant::DICTIONARY, "cycle")));
 	ADD_SIGNAL(MethodInfo("tag_group_initialized", PropertyInfo(Variant::STRING, "tag_group_name")));
+	ADD_SIGNAL(MethodInfo("tag_values_changed", PropertyInfo(Variant::DICTIONARY, "changes")));
 	ADD_SIGNAL(MethodInfo("comms_error"));
+	ADD_SIGNAL(MethodInfo("comms_stalled", PropertyInfo(Variant::DICTIONARY, "diagnostics")));
 	ADD_SIGNAL(MethodInfo("tag_groups_registered"));
 	ADD_SIGNAL(MethodInfo("enable_comms_changed"));
 }
 
-void OIPComms::register_tag_group(const String p_tag_group_name, const int p_polling_interval, const String p_protocol, const String p_gateway, const String p_path, const String p_cpu) {
+// the draft is copied on the first edit after it was published, the published version
+// is never touched again. the same goes for each tag group in it
+OIPComms::CommsConfig &OIPComms::edit_config() {
+	if (config_draft->version <= published_config_version) {
+		config_draft = std::make_shared<CommsConfig>(*config_draft);
+		config_draft->version = published_config_version + 1;
+	}
+	return *config_draft;
+}
+
+OIPComms::TagGroupConfig *OIPComms::edit_tag_group_config(const String &tag_group_name) {
+	CommsConfig &comms_config = edit_config();
+	auto tag_group_it = comms_config.tag_groups.find(tag_group_name);
+	if (tag_group_it == comms_config.tag_groups.end())
+		return nullptr;
+
+	if (tag_group_it->second->version <= published_config_version) {
+		tag_group_it->second = std::make_shared<TagGroupConfig>(*tag_group_it->second);
+		tag_group_it->second->version = comms_config.version;
+	}
+	return tag_group_it->second.get();
+}
+
+void OIPComms::publish_config() {
+	if (config_draft->version > published_config_version) {
+		config.publish(config_draft);
+		published_config_version = config_draft->version;
+	}
+	config.reclaim();
+}
+
+const OIPComms::TagGroupConfig *OIPComms::find_tag_group_config(const String &tag_group_name) {
+	auto tag_group_it = config_draft->tag_groups.find(tag_group_name);
+	return tag_group_it != config_draft->tag_groups.end() ? tag_group_it->second.get() : nullptr;
+}
+
+OIPComms::TagSlot *OIPComms::find_tag_slot(const String &tag_group_name, const String &tag_name, const TagGroupConfig **tag_group_config) {
+	const TagGroupConfig *found = find_tag_group_config(tag_group_name);
+	if (found == nullptr)
+		return nullptr;
+
+	auto tag_it = found->tags.find(tag_name);
+	if (tag_it == found->tags.end())
+		return nullptr;
+
+	if (tag_group_config != nullptr)
+		*tag_group_config = found;
+	return tag_it->second.slot.get();
+}
+
+void OIPComms::register_tag_group(const String p_tag_group_name, const int p_polling_interval, const String p_protocol, const String p_gateway, const String p_path, const String p_cpu, const int p_timeout) {
 	if (p_tag_group_name.is_empty()) return;
 
 	String _gateway = p_gateway;
 	if (_gateway.to_lower().contains("localhost"))
 		_gateway = _gateway.replace("localhost", "127.0.0.1");
 
-	if (tag_group_exists(p_tag_group_name)) {
-		print("Tag group [" + p_tag_group_name + "] already exists. Overwriting with new values.");
+	if (find_tag_group_config(p_tag_group_name) != nullptr) {
+		print("Tag group [" + p_tag_group_name + "] already exists. Overwriting with new values.", OIPLogger::LEVEL_WARNING);
 
 		// probably don't need to do this here
 		//queue_tag_group("_CLEANUP_TAG_GROUPS");
 	}
 
-	TagGroup tag_group = {
-		p_polling_interval,
-		p_polling_interval * 1.0f,
-		0,
-		false,
-
-		p_protocol,
-
-		_gateway,
-
-		p_path,
-		p_cpu,
-		std::map<String, PlcTag>(),
-
-		nullptr,
-		std::map<String, OpcUaTag>()
-	};
-
-	tag_groups[p_tag_group_name] = tag_group;
+	CommsConfig &comms_config = edit_config();
+
+	// a new slot tells the worker to drop what it has for the group and start over
+	std::shared_ptr<TagGroupConfig> tag_group = std::make_shared<TagGroupConfig>();
+	tag_group->version = comms_config.version;
+	tag_group->polling_interval = p_polling_interval;
+	tag_group->timeout = std::max(p_timeout, 0);
+	tag_group->protocol = p_protocol;
+	tag_group->gateway = _gateway;
+	tag_group->path = p_path;
+	tag_group->cpu = p_cpu;
+	tag_group->slot = std::make_shared<TagGroupSlot>();
+	tag_group->slot->time = p_polling_interval * 1.0f;
+	tag_group->slot->interval = p_polling_interval;
+
+	comms_config.tag_groups[p_tag_group_name] = tag_group;
 	print("Tag group registered: " + p_tag_group_name);
 }
 
-bool OIPComms::register_tag(const String p_tag_group_name, const String p_tag_name, const int p_elem_count) {
+bool OIPComms::register_tag(const String p_tag_group_name, const String p_tag_name, const int p_elem_count, const double p_deadband, const double p_deadband_percent, const String p_type) {
 	if (p_tag_group_name.is_empty() || p_tag_name.is_empty())
 		return false;
 
-	if (tag_group_exists(p_tag_group_name)) {
+	const int type = oip_type_index(p_type);
+	if (!p_type.is_empty() && type < 0) {
+		print("Invalid type " + p_type + " for tag " + p_tag_name, true);
+		return false;
+	}
 
-		if (!tag_exists(p_tag_group_name, p_tag_name)) {
-			TagGroup &tag_group = tag_groups[p_tag_group_name];
-			if (tag_group.protocol == "opc_ua") {
-				OpcUaTag tag = { false, UA_NODEID_NULL, { 0 } };
-				tag_group.opc_ua_tags[p_tag_name] = tag;
-			} else {
-				PlcTag tag = { false, -1, p_elem_count, false };
-				tag_group.plc_tags[p_tag_name] = tag;
+	const TagGroupConfig *tag_group_config = find_tag_group_config(p_tag_group_name);
+	if (tag_group_config != nullptr) {
+		// the raw bytes of a PLC tag don't say whether they hold an integer or a float. UDT
+		// fields have theirs from the layout, a tag registered again may have had it before
+		auto existing = tag_group_config->tags.find(p_tag_name);
+		const bool typed = type >= 0 || (existing != tag_group_config->tags.end() && (existing->second.type >= 0 || existing->second.field_index >= 0));
+		if (tag_group_config->protocol != "opc_ua" && (p_deadband > 0.0 || p_deadband_percent > 0.0) && !typed) {
+			print("Deadband of PLC tag " + p_tag_name + " needs its type, e.g. \"float32\"", true);
+			return false;
+		}
+
+		TagGroupConfig &tag_group = *edit_tag_group_config(p_tag_group_name);
+
+		auto tag_it = tag_group.tags.find(p_tag_name);
+		if (tag_it == tag_group.tags.end()) {
+			TagConfig tag = { p_elem_count, p_deadband, p_deadband_percent, type };
+			tag.slot = std::make_shared<TagSlot>();
+			tag.slot->deadband.absolute = p_deadband;
+			tag.slot->deadband.percent = p_deadband_percent;
+
+			if (tag_group.protocol == "opc_ua" && !oip_parse_node_id(p_tag_name, tag_group.path, tag.slot->node_id)) {
+				print("Invalid node id: " + p_tag_name, true);
+				return false;
 			}
+
+			// a bit of a registered bit field is served from the bit field's buffer
+			String base;
+			int bit;
+			if (oip_split_bit(p_tag_name, base, bit)) {
+				auto base_it = tag_group.tags.find(base);
+				if (base_it != tag_group.tags.end() && base_it->second.bit_field) {
+					tag.elem_count = 1;
+					tag.owner_tag_name = base;
+					tag.bit_index = bit;
+				}
+			}
+
+			tag_group.tags[p_tag_name] = tag;
 			print("Registered tag " + p_tag_name + " under tag group " + p_tag_group_name);
+		} else {
+			// registering again only updates the deadband
+			TagConfig &tag = tag_it->second;
+			tag.deadband = p_deadband;
+			tag.deadband_percent = p_deadband_percent;
+			if (type >= 0)
+				tag.type = type;
+			tag.slot->deadband.absolute = p_deadband;
+			tag.slot->deadband.percent = p_deadband_percent;
 		}
 
 		return true;
@@ -577,8 +2925,100 @@ bool OIPComms::register_tag(const String p_tag_group_name, const String p_tag_na
 	}
 }
 
+// fields is an array of dictionaries, one per member of the UDT:
+// { "name": "Speed", "type": "float32", "offset": 4 } and optionally "bit" for BOOL members
+// the whole tag is read in one transaction and each member is decoded at its offset
+bool OIPComms::register_udt_tag(const String p_tag_group_name, const String p_tag_name, const Array p_fields) {
+	const TagGroupConfig *tag_group_config = find_tag_group_config(p_tag_group_name);
+	if (tag_group_config != nullptr && tag_group_config->protocol == "opc_ua") {
+		print("UDT tags are only supported by PLC tag groups: " + p_tag_name, true);
+		return false;
+	}
+
+	std::vector<PlcField> fields;
+	for (int64_t i = 0; i < p_fields.size(); i++) {
+		Dictionary field = p_fields[i];
+		String name = field.get("name", "");
+		int type = oip_type_index(field.get("type", ""));
+		int offset = field.get("offset", -1);
+		int bit = field.get("bit", -1);
+		if (name.is_empty() || type < 0 || offset < 0) {
+			print("Invalid field " + itos(i) + " in UDT layout of " + p_tag_name, true);
+			return false;
+		}
+		fields.push_back({ name, (uint8_t)type, offset, bit, field.get("deadband", 0.0), field.get("deadband_percent", 0.0) });
+	}
+
+	if (!register_tag(p_tag_group_name, p_tag_name, 1, 0.0, 0.0))
+		return false;
+
+	TagGroupConfig &tag_group = *edit_tag_group_config(p_tag_group_name);
+	tag_group.tags[p_tag_name].fields = fields;
+
+	// members of an earlier layout which are gone from this one become tags of their own
+	for (auto &x : tag_group.tags) {
+		TagConfig &member = x.second;
+		if (member.owner_tag_name != p_tag_name || member.field_index < 0)
+			continue;
+		const String field_name = x.first.substr(p_tag_name.length() + 1);
+		if (std::none_of(fields.begin(), fields.end(), [&](const PlcField &field) { return field.name == field_name; })) {
+			member.owner_tag_name = "";
+			member.field_index = -1;
+		}
+	}
+	for (size_t i = 0; i < fields.size(); i++) {
+		const PlcField &field = fields[i];
+		TagConfig &member = tag_group.tags[p_tag_name + "." + field.name];
+		if (member.slot == nullptr)
+			member.slot = std::make_shared<TagSlot>();
+		member.elem_count = 1;
+		member.deadband = field.deadband;
+		member.deadband_percent = field.deadband_percent;
+		member.owner_tag_name = p_tag_name;
+		member.field_index = (int)i;
+		member.slot->deadband.absolute = field.deadband;
+		member.slot->deadband.percent = field.deadband_percent;
+	}
+	print("Registered UDT tag " + p_tag_name + " with " + itos(fields.size()) + " fields under tag group " + p_tag_group_name);
+	return true;
+}
+
+// a word or BOOL array read as a whole, whose bits are registered as tags of their own
+bool OIPComms::register_bit_field(const String p_tag_group_name, const String p_tag_name, const int p_elem_count) {
+	const TagGroupConfig *tag_group_config = find_tag_group_config(p_tag_group_name);
+	if (tag_group_config != nullptr && (tag_group_config->protocol == "opc_ua" || oip_modbus_protocol(tag_group_config->protocol))) {
+		print("Bit fields are only supported by PLC tag groups: " + p_tag_name, true);
+		return false;
+	}
+
+	if (!register_tag(p_tag_group_name, p_tag_name, p_elem_count, 0.0, 0.0))
+		return false;
+
+	edit_tag_group_config(p_tag_group_name)->tags[p_tag_name].bit_field = true;
+	return true;
+}
+
+// an OPC UA tag whose polls only read index_range of its array value
+bool OIPComms::register_array_tag(const String p_tag_group_name, const String p_tag_name, const String p_index_range) {
+	const TagGroupConfig *tag_group_config = find_tag_group_config(p_tag_group_name);
+	if (tag_group_config != nullptr && tag_group_config->protocol != "opc_ua") {
+		print("Array tags are only supported by OPC UA tag groups: " + p_tag_name, true);
+		return false;
+	}
+	if (!oip_valid_index_range(p_index_range)) {
+		print("Invalid index range " + p_index_range + " of " + p_tag_name, true);
+		return false;
+	}
+
+	if (!register_tag(p_tag_group_name, p_tag_name, 1, 0.0, 0.0))
+		return false;
+
+	edit_tag_group_config(p_tag_group_name)->tags[p_tag_name].index_range = p_index_range;
+	return true;
+}
+
 void OIPComms::set_enable_comms(bool value) {
-	enable_comms = value;
+	enable_comms.store(value);
 	if (value) {
 		print("Communications enabled");
 	} else {
@@ -587,13 +3027,21 @@ void OIPComms::set_enable_comms(bool value) {
 }
 
 bool OIPComms::get_enable_comms() {
-	return enable_comms;
+	return enable_comms.load();
 }
 
 void OIPComms::set_sim_running(bool value) {
-	sim_running = value;
+	sim_running.store(value);
 	if (value) {
 		comms_error = false;
+
+		// the worker starts out with everything registered so far
+		publish_config();
+		frame_max_usec = 0;
+		value_changes_held = false;
+		demand_reads = 0;
+		demand_skipped_reads = 0;
+		demand_skipped_bytes = 0;
 		print("Sim running");
 	} else {
 		print("Sim stopped");
@@ -604,7 +3052,7 @@ void OIPComms::set_sim_running(bool value) {
 }
 
 bool OIPComms::get_sim_running() {
-	return sim_running;
+	return sim_running.load();
 }
 
 void OIPComms::set_enable_log(bool value) {
@@ -626,22 +3074,207 @@ String OIPComms::get_comms_error() {
 	return last_error;
 }
 
+void OIPComms::set_stall_threshold(const int p_threshold) {
+	stall_threshold = std::max(p_threshold, 1);
+}
+
+int OIPComms::get_stall_threshold() {
+	return stall_threshold;
+}
+
+void OIPComms::set_abort_stalled(const bool p_abort) {
+	abort_stalled = p_abort;
+}
+
+bool OIPComms::get_abort_stalled() {
+	return abort_stalled;
+}
+
+void OIPComms::set_process_clock(const String p_clock) {
+	if (p_clock != "process_frame" && p_clock != "physics_frame" && p_clock != "fixed") {
+		print("Unknown process clock: " + p_clock, true);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(process_clock_mutex);
+		process_clock = p_clock;
+	}
+	fixed_clock = p_clock == "fixed";
+	if (scene_signals_set)
+		connect_process_clock();
+	print("Process clock: " + p_clock);
+}
+
+String OIPComms::get_process_clock() {
+	std::lock_guard<std::mutex> lock(process_clock_mutex);
+	return process_clock;
+}
+
+void OIPComms::set_fixed_tick_rate(const int p_rate) {
+	fixed_tick_rate = std::max(p_rate, 1);
+}
+
+int OIPComms::get_fixed_tick_rate() {
+	return fixed_tick_rate;
+}
+
+void OIPComms::set_frame_budget_usec(const int p_budget) {
+	frame_budget_usec = std::max(p_budget, 0);
+}
+
+int OIPComms::get_frame_budget_usec() {
+	return frame_budget_usec;
+}
+
+void OIPComms::set_demand_polling(const int p_window) {
+	demand_window = std::max(p_window, 0);
+}
+
+int OIPComms::get_demand_polling() {
+	return demand_window;
+}
+
+Dictionary OIPComms::get_demand_polling_stats() {
+	Dictionary stats;
+	stats["reads"] = demand_reads.load();
+	stats["reads_skipped"] = demand_skipped_reads.load();
+	stats["bytes_skipped"] = demand_skipped_bytes.load();
+	return stats;
+}
+
+void OIPComms::set_adaptive_polling(const String p_tag_group_name, const int p_max_polling_interval) {
+	TagGroupConfig *tag_group = edit_tag_group_config(p_tag_group_name);
+	if (tag_group == nullptr) {
+		print("Tag group not found: " + p_tag_group_name, true);
+		return;
+	}
+
+	tag_group->max_polling_interval = p_max_polling_interval > tag_group->polling_interval ? p_max_polling_interval : 0;
+	tag_group->slot->interval = tag_group->polling_interval;
+}
+
+int OIPComms::get_polling_interval(const String p_tag_group_name) {
+	const TagGroupConfig *tag_group_config = find_tag_group_config(p_tag_group_name);
+	return tag_group_config != nullptr ? tag_group_config->slot->interval.load() : 0;
+}
+
+// -1 until the tag has a value
+int64_t OIPComms::get_tag_age_usec(const String p_tag_group_name, const String p_tag_name) {
+	TagSlot *slot = find_tag_slot(p_tag_group_name, p_tag_name);
+	const uint64_t received_usec = slot != nullptr ? slot->received_usec.load() : 0;
+	if (received_usec == 0)
+		return -1;
+	return (int64_t)(Time::get_singleton()->get_ticks_usec() - received_usec);
+}
+
+Dictionary OIPComms::get_tag_timestamps(const String p_tag_group_name, const String p_tag_name) {
+	Dictionary timestamps;
+	TagSlot *slot = find_tag_slot(p_tag_group_name, p_tag_name);
+	if (slot == nullptr || slot->received_usec == 0)
+		return timestamps;
+
+	const uint64_t received_usec = slot->received_usec;
+	timestamps["received_usec"] = received_usec;
+	timestamps["age_usec"] = (int64_t)(Time::get_singleton()->get_ticks_usec() - received_usec);
+	timestamps["cycle_seq"] = slot->cycle_seq.load();
+
+	std::lock_guard<std::mutex> lock(opc_ua_values_mutex);
+	timestamps["source_time_usec"] = oip_unix_usec(slot->source_timestamp);
+	timestamps["server_time_usec"] = oip_unix_usec(slot->server_timestamp);
+	return timestamps;
+}
+
+Dictionary OIPComms::get_gateway_stats() {
+	Dictionary stats;
+	std::lock_guard<std::mutex> lock(gateway_rtts_mutex);
+	for (const auto &x : gateway_rtts) {
+		const GatewayRtt &rtt = x.second;
+		Dictionary gateway;
+		gateway["srtt_msec"] = rtt.srtt;
+		gateway["rttvar_msec"] = rtt.rttvar;
+		gateway["timeout_msec"] = rtt.timeout(timeout);
+		gateway["samples"] = rtt.samples;
+		stats[x.first] = gateway;
+	}
+	return stats;
+}
+
+Dictionary OIPComms::get_main_thread_stats() {
+	Dictionary stats;
+	stats["clock"] = get_process_clock();
+	stats["last_usec"] = frame_usec;
+	stats["average_usec"] = frame_average_usec;
+	stats["max_usec"] = frame_max_usec;
+	stats["deferred"] = frame_deferred;
+	return stats;
+}
+
 Array OIPComms::get_tag_groups() {
 	Array groups;
 
-	for (const auto &x : tag_groups) {
+	for (const auto &x : config_draft->tag_groups) {
 		groups.push_back(x.first);
 	}
 
 	return groups;
 }
 
+bool OIPComms::start_recording(const String p_path) {
+	String path = ProjectSettings::get_singleton()->globalize_path(p_path);
+
+	// 8 MiB of ring buffers a few hundred milliseconds of a busy worker
+	if (!recorder.start(oip_utf8(path), 8 * 1024 * 1024)) {
+		print("Failed to start recording to " + path, true);
+		return false;
+	}
+	print("Recording to " + path);
+	return true;
+}
+
+void OIPComms::stop_recording() {
+	if (!recorder.is_recording())
+		return;
+
+	recorder.stop();
+	print("Recording stopped, " + itos(recorder.get_records()) + " records written, " + itos(recorder.get_dropped()) + " dropped");
+}
+
+Dictionary OIPComms::get_recording_stats() {
+	Dictionary stats;
+	stats["recording"] = recorder.is_recording();
+	stats["records"] = recorder.get_records();
+	stats["dropped"] = recorder.get_dropped();
+	stats["bytes_written"] = recorder.get_bytes_written();
+	return stats;
+}
+
+void OIPComms::set_enable_profiling(bool value) {
+	profiler.set_enabled(value);
+}
+
+bool OIPComms::get_enable_profiling() {
+	return profiler.is_enabled();
+}
+
+bool OIPComms::dump_profile(const String p_path) {
+	String path = ProjectSettings::get_singleton()->globalize_path(p_path);
+
+	String error;
+	if (!profiler.dump(path, error)) {
+		print("Failed to write profile to " + path + ": " + error, true);
+		return false;
+	}
+	print("Profile written to " + path + (profiler.get_dropped() > 0 ? ", " + itos(profiler.get_dropped()) + " spans dropped so far" : String()));
+	return true;
+}
+
 void OIPComms::clear_tag_groups() {
-	if (sim_running)
+	if (sim_running.load())
 		print("Can't clear tag group when simulation is running");
 	else {
 		print("Clearing tag groups");
-		tag_groups.clear();
+		edit_config().tag_groups.clear();
 	}
 }
 
@@ -650,24 +3283,30 @@ void OIPComms::clear_tag_groups() {
 // need to be a little more careful with thread safety. don't use pass by reference here, copy values
 // writes get queued, so should be fine
 
-#define OIP_READ_FUNC(a, b, c)                                                        \
-	b OIPComms::read_##a(const String p_tag_group_name, const String p_tag_name) { \
-		if (enable_comms && sim_running && tag_exists(p_tag_group_name, p_tag_name)) {                                         \
-			TagGroup &tag_group = tag_groups[p_tag_group_name];                    \
-			if (tag_group.protocol == "opc_ua") {                                  \
-				OpcUaTag tag = tag_group.opc_ua_tags[p_tag_name];                  \
-				if (tag.initialized && UA_Variant_hasScalarType(&tag.value, &UA_TYPES[UA_TYPES_##c])) { \
-					return *(b *)tag.value.data; \
-				} else { return 0.0; } \
-			} else {                                                               \
-				PlcTag tag = tag_group.plc_tags[p_tag_name];                      \
-				if (tag.initialized) {                                           \
-					int32_t tag_pointer = tag.tag_pointer;                     \
-					return plc_tag_get_##a(tag_pointer, 0);                     \
-				} else { return 0.0; }                                             \
-			}                                                                      \
-		}                                                                          \
-		return 0.0;                                                                 \
+#define OIP_READ_FUNC(a, b, c)                                                                                      \
+	b OIPComms::read_##a(const String p_tag_group_name, const String p_tag_name) {                               \
+		const TagGroupConfig *tag_group_config = nullptr;                                                        \
+		TagSlot *slot = enable_comms.load() && sim_running.load() ? find_tag_slot(p_tag_group_name, p_tag_name, &tag_group_config) : nullptr; \
+		if (slot != nullptr)                                                                                     \
+			touch_tag(p_tag_group_name, *tag_group_config, *slot);                                               \
+		if (slot != nullptr && slot->initialized) {                                                              \
+			if (tag_group_config->protocol == "opc_ua") {                                                        \
+				std::lock_guard<std::mutex> lock(opc_ua_values_mutex);                                          \
+				if (UA_Variant_hasScalarType(&slot->value, &UA_TYPES[UA_TYPES_##c])) {                          \
+					return *(b *)slot->value.data;                                                              \
+				} else { return 0.0; }                                                                           \
+			} else {                                                                                             \
+				int offset = slot->offset;                                                                     \
+				if (UA_TYPES_##c == UA_TYPES_BOOLEAN) offset = offset * 8 + slot->bit;                          \
+				TagSlot *memory_slot = slot->memory_slot;                                                        \
+				if (memory_slot != nullptr) {                                                                    \
+					std::lock_guard<std::mutex> lock(plc_memory_mutex);                                          \
+					return oip_memory_get_##a(memory_slot->memory, offset);                                      \
+				}                                                                                                \
+				return plc_tag_get_##a(slot->tag_pointer, offset);                                               \
+			}                                                                                                    \
+		}                                                                                                        \
+		return 0.0;                                                                                              \
 	}
 
 OIP_READ_FUNC(bit, bool, BOOLEAN)
@@ -682,17 +3321,129 @@ OIP_READ_FUNC(int8, int8_t, INT16)
 OIP_READ_FUNC(float64, double, DOUBLE)
 OIP_READ_FUNC(float32, float, FLOAT)
 
+// the polled value of an OPC UA tag as a packed array, in a single copy for the element
+// types Godot has a packed array of
+Variant OIPComms::read_array(const String p_tag_group_name, const String p_tag_name) {
+	const TagGroupConfig *tag_group_config = nullptr;
+	TagSlot *slot = enable_comms.load() && sim_running.load() ? find_tag_slot(p_tag_group_name, p_tag_name, &tag_group_config) : nullptr;
+	if (slot == nullptr || tag_group_config->protocol != "opc_ua")
+		return Variant();
+	touch_tag(p_tag_group_name, *tag_group_config, *slot);
+
+	std::lock_guard<std::mutex> lock(opc_ua_values_mutex);
+	return oip_variant_to_packed(slot->value);
+}
+
+// length of each dimension of a matrix, the length of a plain array, empty for scalars
+PackedInt32Array OIPComms::get_array_dimensions(const String p_tag_group_name, const String p_tag_name) {
+	PackedInt32Array dimensions;
+	const TagGroupConfig *tag_group_config = nullptr;
+	TagSlot *slot = enable_comms.load() && sim_running.load() ? find_tag_slot(p_tag_group_name, p_tag_name, &tag_group_config) : nullptr;
+	if (slot == nullptr || tag_group_config->protocol != "opc_ua")
+		return dimensions;
+
+	std::lock_guard<std::mutex> lock(opc_ua_values_mutex);
+	const UA_Variant &value = slot->value;
+	if (value.type == nullptr || UA_Variant_isScalar(&value))
+		return dimensions;
+	if (value.arrayDimensionsSize == 0) {
+		dimensions.push_back((int32_t)value.arrayLength);
+		return dimensions;
+	}
+	for (size_t i = 0; i < value.arrayDimensionsSize; i++) {
+		dimensions.push_back((int32_t)value.arrayDimensions[i]);
+	}
+	return dimensions;
+}
+
+void OIPComms::write_array(const String p_tag_group_name, const String p_tag_name, const Variant p_value, const String p_index_range) {
+	const TagGroupConfig *tag_group_config = nullptr;
+	TagSlot *slot = enable_comms.load() && sim_running.load() ? find_tag_slot(p_tag_group_name, p_tag_name, &tag_group_config) : nullptr;
+	if (slot == nullptr)
+		return;
+	if (tag_group_config->protocol != "opc_ua") {
+		print("Array writes are only supported by OPC UA tag groups: " + p_tag_name, true);
+		return;
+	}
+	if (!oip_valid_index_range(p_index_range)) {
+		print("Invalid index range " + p_index_range + " of " + p_tag_name, true);
+		return;
+	}
+
+	WriteRequest write_req = { 11, p_tag_group_name, p_tag_name, p_value, p_index_range };
+	queue_write(write_req);
+	if (tag_group_config->max_polling_interval > 0)
+		tag_group_config->slot->interval = tag_group_config->polling_interval;
+}
+
+// every bit of a bit field, unpacked straight out of its buffer
+PackedByteArray OIPComms::read_bits(const String p_tag_group_name, const String p_tag_name) {
+	PackedByteArray bits;
+	const TagGroupConfig *tag_group_config = nullptr;
+	TagSlot *slot = enable_comms.load() && sim_running.load() ? find_tag_slot(p_tag_group_name, p_tag_name, &tag_group_config) : nullptr;
+	if (slot == nullptr || !tag_group_config->tags.at(p_tag_name).bit_field)
+		return bits;
+	touch_tag(p_tag_group_name, *tag_group_config, *slot);
+	if (!slot->initialized)
+		return bits;
+
+	std::lock_guard<std::mutex> lock(plc_memory_mutex);
+	const TagSlot *memory_slot = slot->memory_slot;
+	if (memory_slot != nullptr) {
+		read_bits_buffer = memory_slot->memory;
+	} else {
+		const int size = plc_tag_get_size(slot->tag_pointer);
+		read_bits_buffer.resize(std::max(size, 0));
+		if (size <= 0 || plc_tag_get_raw_bytes(slot->tag_pointer, 0, read_bits_buffer.data(), size) != PLCTAG_STATUS_OK)
+			return bits;
+	}
+
+	bits.resize(read_bits_buffer.size() * 8);
+	oip_unpack_bits(read_bits_buffer.data(), read_bits_buffer.size(), bits.ptrw());
+	return bits;
+}
+
+// decodes every field of a UDT tag through its layout, in registration order
+Array OIPComms::read_udt(const String p_tag_group_name, const String p_tag_name) {
+	Array values;
+	const TagGroupConfig *tag_group_config = nullptr;
+	TagSlot *slot = enable_comms.load() && sim_running.load() ? find_tag_slot(p_tag_group_name, p_tag_name, &tag_group_config) : nullptr;
+	if (slot == nullptr || tag_group_config->protocol == "opc_ua")
+		return values;
+	touch_tag(p_tag_group_name, *tag_group_config, *slot);
+
+	std::lock_guard<std::mutex> lock(plc_memory_mutex);
+	const bool initialized = slot->initialized;
+	const TagSlot *memory_slot = slot->memory_slot;
+	for (const PlcField &field : tag_group_config->tags.at(p_tag_name).fields) {
+		if (!initialized)
+			values.push_back(Variant());
+		else if (memory_slot != nullptr)
+			values.push_back(oip_memory_value(memory_slot->memory, field.type, field.offset, field.bit));
+		else
+			values.push_back(plc_get_value(slot->tag_pointer, field.type, field.offset, field.bit));
+	}
+	return values;
+}
+
 #define OIP_WRITE_FUNC(a, b, c)                                                                                                         \
 	void OIPComms::write_##a(const String p_tag_group_name, const String p_tag_name, const b p_value) {                                 \
-		if (enable_comms && sim_running && tag_exists(p_tag_group_name, p_tag_name)) { \
+		const TagGroupConfig *tag_group_config = nullptr;                                                                               \
+		TagSlot *slot = enable_comms.load() && sim_running.load() ? find_tag_slot(p_tag_group_name, p_tag_name, &tag_group_config) : nullptr; \
+		if (slot != nullptr) {                                                                                                          \
+			Deadband *deadband = c != 0 ? &slot->deadband : nullptr;                                                                    \
+			if (deadband != nullptr && deadband->enabled() &&                                                                           \
+					!deadband->exceeded((double)p_value, deadband->written, deadband->has_written))                                     \
+				return;                                                                                                                 \
 			WriteRequest write_req = {                                                                                                  \
 				c,                                                                                                                      \
 				p_tag_group_name,                                                                                                       \
 				p_tag_name,                                                                                                             \
 				p_value                                                                                                                 \
 			};                                                                                                                          \
-			write_queue.push(write_req);                                                                                                \
-			tag_group_queue.push("");                                                                                                   \
+			queue_write(write_req);                                                                                                     \
+			if (tag_group_config->max_polling_interval > 0)                                                                             \
+				tag_group_config->slot->interval = tag_group_config->polling_interval;                                                  \
 		}                                                                                                                               \
 	}
 
@@ -1,13 +1,17 @@
 #ifndef OIP_COMMS_H
 #define OIP_COMMS_H
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
 #include <thread>
 #include <memory>
+#include <mutex>
 #include <map>
 #include <string>
 #include <vector>
 #include <queue>
+#include <random>
 
 #include "libplctag.h"
 #include "open62541.h"
@@ -16,6 +20,13 @@
 #include <godot_cpp/classes/thread.hpp>
 
 #include "oip_blocking_queue.h"
+#include "oip_deadband.h"
+#include "oip_gateway_rtt.h"
+#include "oip_logger.h"
+#include "oip_profiler.h"
+#include "oip_recorder.h"
+#include "oip_replay.h"
+#include "oip_snapshot.h"
 
 namespace godot {
 
@@ -24,11 +35,173 @@ class OIPComms : public Node {
 
 private:
 	int timeout = 5000;
-	double startup_timer = 0.0f;
-	double register_wait_time = 500.0f;
+
+	// round trip times of the PLC calls to each gateway, they set the read and write timeouts
+	typedef OIPGatewayRtt GatewayRtt;
+	std::map<String, GatewayRtt> gateway_rtts;
+	std::mutex gateway_rtts_mutex;
 	bool comms_error = false;
 	String last_error = "";
 
+	// analog values moving less than this are neither reported nor written
+	typedef OIPDeadband Deadband;
+
+	// one entry of a UDT field layout, decoded straight out of the owning tag's buffer
+	struct PlcField {
+		String name;
+
+		// same numbering as WriteRequest::instruction
+		uint8_t type;
+		int offset;
+		int bit;
+
+		double deadband;
+		double deadband_percent;
+	};
+
+	// state of a registered tag which both threads get to. the configuration holds it by
+	// pointer, so it carries over from one published version to the next
+	struct TagSlot {
+		// where the main thread reads the value from, published by the worker once the tag is
+		// created. memory_slot is set instead of tag_pointer for tags kept in memory
+		std::atomic<bool> initialized{ false };
+		std::atomic<int32_t> tag_pointer{ -1 };
+		std::atomic<int> offset{ 0 };
+		std::atomic<int> bit{ 0 };
+		std::atomic<TagSlot *> memory_slot{ nullptr };
+
+		// value of tags not backed by libplctag (replay, sim), guarded by plc_memory_mutex
+		std::vector<uint8_t> memory;
+
+		// last polled OPC UA value, guarded by opc_ua_values_mutex
+		UA_Variant value;
+
+		// source and server timestamps the OPC UA server sent with the value, 0 when it sent
+		// none. guarded by opc_ua_values_mutex
+		UA_DateTime source_timestamp = 0;
+		UA_DateTime server_timestamp = 0;
+
+		// when the value was last received (Time::get_ticks_usec) and in which poll of its group
+		std::atomic<uint64_t> received_usec{ 0 };
+		std::atomic<uint64_t> cycle_seq{ 0 };
+
+		// write filter, only used by the main thread
+		Deadband deadband;
+
+		// last read_* of the tag on the main thread, for demand polling
+		std::atomic<uint64_t> last_access{ 0 };
+
+		// node of an OPC UA tag, parsed once when the tag is registered and only read after
+		UA_NodeId node_id;
+
+		TagSlot() {
+			UA_Variant_init(&value);
+			UA_NodeId_init(&node_id);
+		}
+
+		// unpublished again, until the tag is created on the next run
+		void reset() {
+			initialized = false;
+			tag_pointer = -1;
+			memory_slot = nullptr;
+			memory.clear();
+			UA_Variant_clear(&value);
+			source_timestamp = 0;
+			server_timestamp = 0;
+			received_usec = 0;
+			cycle_seq = 0;
+		}
+		~TagSlot() {
+			UA_Variant_clear(&value);
+			UA_NodeId_clear(&node_id);
+		}
+	};
+
+	// per group counterpart of TagSlot
+	struct TagGroupSlot {
+		// set by the worker once every tag in the group has been created
+		std::atomic<bool> ready{ false };
+
+		// polling interval in effect, differs from the registered one with adaptive polling.
+		// read by the tick thread on the fixed clock
+		std::atomic<int> interval{ 0 };
+
+		// main thread only
+		double time = 0.0;
+		bool init_count_emitted = false;
+
+		// frame in which demand polling last fetched the group, so it is queued once per frame
+		uint64_t demand_fetch_ticks = 0;
+	};
+
+	// configuration, as registered by the scripts. it is built on the main thread and handed
+	// to the worker as immutable versions, see OIPSnapshot
+	struct TagConfig {
+		int elem_count;
+		double deadband;
+		double deadband_percent;
+
+		// data type a deadbanded PLC tag is decoded in, same numbering as WriteRequest::instruction.
+		// -1 when none was given
+		int type = -1;
+
+		// layout of a UDT tag. its fields are registered as tags of their own, "Tag.Field",
+		// which point back at the UDT tag through owner_tag_name and field_index
+		std::vector<PlcField> fields;
+		String owner_tag_name;
+		int field_index = -1;
+
+		// word or BOOL array whose bits can be registered as tags of their own, "Word.5" or
+		// "Bits[37]". those point back at it through owner_tag_name and bit_index
+		bool bit_field = false;
+		int bit_index = -1;
+
+		// OPC UA NumericRange the polls read, "0:99" or "0:1,0:3" for part of a matrix.
+		// empty reads the whole value
+		String index_range;
+
+		std::shared_ptr<TagSlot> slot;
+	};
+
+	struct TagGroupConfig {
+		// version of the configuration this copy was made for, older ones are published and frozen
+		uint64_t version;
+
+		int polling_interval;
+
+		// fixed timeout of the group in ms, 0 to follow the round trip times of its gateway
+		int timeout;
+
+		// adaptive polling: the interval backs off from polling_interval toward this while the
+		// values stay the same, 0 when the group is always polled at polling_interval
+		int max_polling_interval = 0;
+
+		String protocol;
+		String gateway;
+		String path;
+		String cpu;
+		std::map<String, TagConfig> tags;
+
+		std::shared_ptr<TagGroupSlot> slot;
+	};
+
+	struct CommsConfig {
+		uint64_t version = 0;
+		std::map<String, std::shared_ptr<TagGroupConfig>> tag_groups;
+	};
+
+	// the main thread edits config_draft, which is published at the start of the next frame.
+	// the worker pins the published version for each work item
+	std::shared_ptr<CommsConfig> config_draft = std::make_shared<CommsConfig>();
+	uint64_t published_config_version = 0;
+	OIPSnapshot<CommsConfig> config;
+
+	CommsConfig &edit_config();
+	TagGroupConfig *edit_tag_group_config(const String &tag_group_name);
+	void publish_config();
+	const TagGroupConfig *find_tag_group_config(const String &tag_group_name);
+	TagSlot *find_tag_slot(const String &tag_group_name, const String &tag_name, const TagGroupConfig **tag_group_config = nullptr);
+
 	struct PlcTag {
 		bool initialized = false;
 		int32_t tag_pointer = -1;
@@ -38,48 +211,246 @@ private:
 		// TBD - in the future expose an API so that "immediate reads" can occur
 		// a little tricky with the current blocking queue/thread implementation
 		bool dirty;
+
+		// field layout of a UDT tag, empty for plain tags
+		std::vector<PlcField> fields;
+
+		// name sent to the PLC when it differs from the registered name (coalesced blocks, Modbus addresses)
+		String name;
+
+		// coalesced block, not registered by the scripts - only its members are
+		bool block = false;
+
+		// size of one element in bytes, read back from libplctag once the tag is created
+		int elem_size;
+
+		// data type registered for the deadband, -1 when none was given
+		int type = -1;
+
+		// names of the members served from this tag's buffer
+		std::vector<String> members;
+
+		// raw buffer of the last poll, compared against the next one to find changed values
+		std::vector<uint8_t> image;
+
+		Deadband deadband;
+
+		// null for coalesced blocks
+		std::shared_ptr<TagSlot> slot;
+
+		// id of the tag in the current recording, valid while trace_session matches the recorder
+		uint32_t trace_id = 0;
+		uint32_t trace_session = 0;
+	};
+
+	// a member is addressed by its own name but served from the buffer of another tag,
+	// e.g. "Conveyor.Speed" out of "Conveyor". writes go through a separate handle so
+	// the rest of the owning tag never gets written back with stale data
+	struct PlcMember {
+		String tag_name;
+		int offset;
+		int bit;
+		int32_t write_pointer = -1;
+
+		// element of a coalesced array block - the byte offset is elem_index * elem_size of the block
+		int elem_index;
+
+		// size in bytes, 0 for array elements which take the elem_size of their block
+		int size;
+
+		// type from the UDT layout or registered with the element, -1 when none was given
+		int type;
+
+		Deadband deadband;
+
+		std::shared_ptr<TagSlot> slot;
+
+		// defined in the recording together with the owning tag
+		uint32_t trace_id = 0;
+		uint32_t trace_session = 0;
 	};
 
 	struct OpcUaTag {
 		bool initialized = false;
 		UA_NodeId node_id;
-		UA_Variant value;
+
+		// optimized id handed back by the RegisterNodes service, only valid for the current session
+		UA_NodeId registered_node_id;
 
 		// no implementation of "dirty" tags here - see if needed on the PLC interface
+
+		Deadband deadband;
+
+		// write storage, kept apart from the polled value. write_value points into write_data
+		// without owning it, so writes never allocate
+		UA_Variant write_value = {};
+		uint64_t write_data = 0;
+
+		// index range of the polls, lent to every read request. empty for the whole value
+		std::string index_range;
+
+		std::shared_ptr<TagSlot> slot;
+
+		uint32_t trace_id = 0;
+		uint32_t trace_session = 0;
 	};
 
+	// runtime state of a tag group, only used by the worker. it is created from the
+	// configuration and follows it as new versions are published
 	struct TagGroup {
-		int polling_interval;
-		double time;
-		size_t init_count;
-		bool init_count_emitted;
+		uint64_t config_version = 0;
+		std::shared_ptr<TagGroupSlot> slot;
+
+		size_t init_count = 0;
+
+		// counters of the poll in progress, reported through tag_group_poll_completed
+		uint64_t poll_seq = 0;
+		int poll_tags_read = 0;
+		int poll_tags_changed = 0;
+		int poll_failures = 0;
 
 		String protocol;
+		int timeout = 0;
 
-		// gateway is a multi-purpose field. either the IP address of a PLC, "192.168.1.200"
-		// or the address of an OPC UA server endpoint, "opc.tcp://192.168.56.104:62541"
+		// gateway is a multi-purpose field. either the IP address of a PLC, "192.168.1.200",
+		// the address of an OPC UA server endpoint, "opc.tcp://192.168.56.104:62541"
+		// or the trace file of a replay group, "user://line1.oiptrace"
 		String gateway;
 
-		// path is a multi-purpose field. it is the rack/slot number of a PLC, "1,2"
-		// or the namespace address of an OPC UA server, "1"
+		// path is a multi-purpose field. it is the rack/slot number of a PLC, "1,2",
+		// the namespace address of an OPC UA server, "1" or the speed of a replay, "10"
 		String path;
 
+		// the PLC type, the recorded tag group a replay group plays back (default: its own name)
+		// or the failure rate of a sim group in percent. for sim groups gateway and path are
+		// the latency and jitter in ms
 		String cpu;
 		std::map<String, PlcTag> plc_tags;
+		std::map<String, PlcMember> plc_members;
 
-		UA_Client *client;
+		// shared with every group on the same endpoint, owned by opc_ua_clients
+		UA_Client *client = nullptr;
 		std::map<String, OpcUaTag> opc_ua_tags;
 
+		// cleared on reconnect and when a tag initializes, so new node ids get registered
+		bool nodes_registered = false;
+
+		// session of the shared client the node ids were registered in
+		uint64_t opc_ua_session = 0;
+
+		// the poll's read request is out, further polls are skipped until it completes
+		bool read_in_flight = false;
+		uint64_t read_start_usec = 0;
+
+		// trace served by a replay group, loaded on its first poll
+		std::shared_ptr<OIPReplay> replay;
+
+		// values held by the simulated device of a sim group, by tag name
+		std::map<String, std::vector<uint8_t>> sim_values;
+
+		// the simulated device answers one request after the other, the last one is due then
+		uint64_t sim_busy_usec = 0;
 	};
 	std::map<String, TagGroup> tag_groups;
+	uint64_t synced_config_version = 0;
+
+	void sync_tag_groups(const CommsConfig &comms_config);
+	void sync_tag_group(TagGroup &tag_group, const TagGroupConfig &tag_group_config);
+	void remove_plc_tag(TagGroup &tag_group, const String &tag_name);
+	static bool plc_coalesced(const TagGroup &tag_group, const String &tag_name);
+	void plc_publish_view(TagGroup &tag_group, PlcTag &tag);
 
+	// instruction 11 writes a packed array to an OPC UA node, through index_range when set
 	struct WriteRequest {
 		uint8_t instruction;
 		String tag_group_name;
 		String tag_name;
 		Variant value;
+		String index_range;
 	};
+	// filled by the main thread, drained by the worker
 	std::queue<WriteRequest> write_queue;
+	std::mutex write_queue_mutex;
+
+	// changes found by the worker, gathered into one tag_values_changed per frame on the main thread
+	struct ValueChange {
+		String tag_group_name;
+		PackedStringArray tag_names;
+	};
+	std::vector<ValueChange> value_changes;
+	std::mutex value_changes_mutex;
+
+	// polls finished by the worker, emitted as tag_group_poll_completed on the main thread.
+	// times are Time::get_ticks_usec
+	struct PollCompletion {
+		String tag_group_name;
+		uint64_t seq;
+		uint64_t start_usec;
+		uint64_t end_usec;
+		int tags_read;
+		int tags_changed;
+		int failures;
+	};
+	std::vector<PollCompletion> poll_completions;
+	std::mutex poll_completions_mutex;
+
+	// guards OPC UA values, the worker replaces them while the main thread reads them
+	std::mutex opc_ua_values_mutex;
+
+	// context of an asynchronous write, taken from the pool of its client and handed back
+	// by the callback. the strings are shared with the request, so taking one doesn't allocate
+	struct OpcUaWrite {
+		OIPComms *comms = nullptr;
+		String gateway;
+		String tag_group_name;
+		String tag_path;
+		uint64_t start_usec = 0;
+		bool in_use = false;
+	};
+
+	// one client, and one session, per OPC UA endpoint. reads and writes of every group on it
+	// go out as asynchronous requests and complete in UA_Client_run_iterate on the worker
+	struct OpcUaClient {
+		UA_Client *client = nullptr;
+
+		// counts the connections made, groups compare it to notice a reconnect
+		uint64_t session = 0;
+		int requests_in_flight = 0;
+
+		// one write context per request the client may have out, allocated with the client
+		std::vector<OpcUaWrite> writes;
+	};
+	std::map<String, OpcUaClient> opc_ua_clients;
+
+	// requests sent ahead on a client before the worker waits for completions
+	static const int OPC_UA_MAX_IN_FLIGHT = 16;
+
+	// while requests are out the worker waits this long for work before serving the clients
+	static const int OPC_UA_ITERATE_USEC = 1000;
+
+	// same for the memory of PLC tags which are not backed by libplctag
+	std::mutex plc_memory_mutex;
+	std::vector<uint8_t> replay_buffer;
+	std::mt19937 sim_random;
+
+	// sim requests waiting out their simulated round trip, by the time they are due. the
+	// worker completes them between items instead of sleeping through the latency
+	struct SimRequest {
+		String tag_group_name;
+		std::shared_ptr<TagGroupSlot> slot;
+
+		// a poll with its sequence number, or a write
+		bool read;
+		uint64_t seq;
+		WriteRequest write_req;
+	};
+	std::multimap<uint64_t, SimRequest> sim_requests;
+
+	// scratch buffer for the raw bytes of a PLC tag, only used on the worker
+	std::vector<uint8_t> plc_read_buffer;
+
+	// same for read_bits, only used on the main thread
+	std::vector<uint8_t> read_bits_buffer;
 
 	Ref<Thread> work_thread;
 	bool work_thread_running = true;
@@ -87,34 +458,174 @@ private:
 	Ref<Thread> watchdog_thread;
 	bool watchdog_thread_running = true;
 
+	// the I/O call the worker is blocked in, watched by the watchdog. start_usec is 0 while idle
+	struct InFlight {
+		String tag_group_name;
+		String tag_name;
+		const char *operation = "";
+		int32_t tag_pointer = -1;
+		uint64_t start_usec = 0;
+		bool reported = false;
+	};
+	InFlight in_flight;
+	std::mutex in_flight_mutex;
+
+	// when the worker last picked an item off the queue
+	std::atomic<uint64_t> worker_heartbeat{ 0 };
+	uint64_t stalled_heartbeat = 0;
+
+	// demand polling: tags not read by a script within the window (ms) are left out of the
+	// polls, 0 polls everything. the counters are kept by the worker
+	std::atomic<int> demand_window{ 0 };
+	std::atomic<uint64_t> demand_reads{ 0 };
+	std::atomic<uint64_t> demand_skipped_reads{ 0 };
+	std::atomic<uint64_t> demand_skipped_bytes{ 0 };
+
+	bool tag_slot_idle(const TagSlot &slot, uint64_t now);
+	bool plc_tag_idle(TagGroup &tag_group, const PlcTag &tag, uint64_t now);
+	void touch_tag(const String &tag_group_name, const TagGroupConfig &tag_group_config, TagSlot &slot);
+
+	std::atomic<int> stall_threshold{ 2000 };
+	std::atomic<bool> abort_stalled{ false };
+
+	// stalls found by the watchdog, emitted as comms_stalled on the main thread
+	struct Stall {
+		String tag_group_name;
+		String tag_name;
+		String operation;
+		uint64_t elapsed_msec;
+		uint64_t heartbeat_age_msec;
+		size_t queued;
+		bool aborted;
+	};
+	std::vector<Stall> stalls;
+	std::mutex stalls_mutex;
+
+	// what process() is connected to: "process_frame", "physics_frame" or "fixed". the fixed
+	// clock queues the groups from tick_thread and leaves process() on process_frame for the
+	// signals, see set_process_clock
+	String process_clock = "process_frame";
+	String connected_clock;
+	std::mutex process_clock_mutex;
+	std::atomic<bool> fixed_clock{ false };
+	std::atomic<int> fixed_tick_rate{ 100 };
+
+	Ref<Thread> tick_thread;
+	bool tick_thread_running = true;
+
+	// polling schedule of the fixed clock, rebuilt by the main thread when a new configuration
+	// is published. groups queued by the tick are emitted as tag_group_polled on the next frame
+	struct TickGroup {
+		String tag_group_name;
+		std::shared_ptr<TagGroupSlot> slot;
+		double time;
+	};
+	std::vector<TickGroup> tick_schedule;
+	uint64_t tick_schedule_version = 0;
+	std::vector<String> tick_polled;
+	std::mutex tick_mutex;
+
+	// cost of process() on the main thread. with a budget, signals which don't fit into it are
+	// held back for the next frame
+	int frame_budget_usec = 0;
+	uint64_t frame_usec = 0;
+	double frame_average_usec = 0.0;
+	uint64_t frame_max_usec = 0;
+	int frame_deferred = 0;
+	bool value_changes_held = false;
+
 	OIPBlockingQueue tag_group_queue;
 
 	uint64_t last_ticks = 0;
 
-	bool scene_signals_set = false;
+	// process() is connected, on the main thread through a call queued by the watchdog
+	std::atomic<bool> scene_signals_set{ false };
+	std::atomic<bool> scene_signals_queued{ false };
 
-	bool enable_comms = true;
-	bool sim_running = false;
+	// set on the main thread, read by the worker and the tick thread
+	std::atomic<bool> enable_comms{ true };
+	std::atomic<bool> sim_running{ false };
 
 	bool enable_log = false;
 
 	void watchdog();
 	void process_work();
+	void tick();
+
+	void io_begin(const String &tag_group_name, const String &tag_name, const char *operation, int32_t tag_pointer = -1);
+	void io_end();
+	void check_stall();
+	void emit_stalls();
+
+	void connect_scene_signals();
+	bool connect_process_clock();
+	void update_tick_schedule();
 
 	void process_tag_group(const String &tag_group_name);
+	void push_poll_completion(const String &tag_group_name, const TagGroup &tag_group, uint64_t start_usec);
 	void process_plc_tag_group(const String &tag_group_name);
 	void process_opc_ua_tag_group(const String &tag_group_name);
-
-	bool init_plc_tag(const String &tag_group_name, const String &tag_name);
+	void process_replay_tag_group(const String &tag_group_name);
+	void process_sim_tag_group(const String &tag_group_name);
+	void process_sim_write(const WriteRequest &write_req);
+	void queue_sim_request(TagGroup &tag_group, const SimRequest &request);
+	void complete_sim_requests();
+	void complete_sim_read(const SimRequest &request);
+	void complete_sim_write(const WriteRequest &write_req);
+	bool sim_failed(const TagGroup &tag_group);
+
+	// tags of every PLC group are created together on the first poll after the sim starts
+	bool plc_tags_created = false;
+
+	String plc_tag_path(const TagGroup &tag_group, const String &tag_name, int elem_count);
+	void create_plc_tags(const std::vector<String> &tag_group_names);
+
+	void coalesce_plc_tags(TagGroup &tag_group);
+	void coalesce_modbus_tags(TagGroup &tag_group);
+
+	int plc_member_offset(const PlcTag &owner, const PlcMember &member);
+	void diff_plc_tag(const String &tag_group_name, TagGroup &tag_group, const String &tag_name, PlcTag &tag, PackedStringArray &changed);
+	bool plc_deadband_exceeded(const PlcTag &tag, int type, int offset, Deadband &deadband);
+	void queue_value_changes(const String &tag_group_name, const PackedStringArray &changed);
+	int emit_value_changes(uint64_t deadline);
+	int emit_poll_completions(uint64_t deadline);
+	void adapt_polling_interval(const String &tag_group_name, bool changed);
+	Variant plc_get_value(int32_t tag_pointer, uint8_t type, int offset, int bit);
+	Variant plc_tag_value(const PlcTag &tag, uint8_t type, int offset, int bit);
+	int32_t plc_member_write_pointer(TagGroup &tag_group, const String &member_name, PlcMember &member);
+	void plc_mirror_member_write(const PlcTag &owner, const PlcMember &member);
 
 	bool init_opc_ua_client(const String &tag_group_name);
 	bool init_opc_ua_tag(const String &tag_group_name, const String &tag_path);
+	void register_opc_ua_nodes(const String &tag_group_name);
+	const UA_NodeId &opc_ua_node_id(const OpcUaTag &tag);
 
 	bool opc_ua_client_connected(const String &tag_group_name);
-	bool tag_group_exists(const String &tag_group_name);
-	bool tag_exists(const String &tag_group_name, const String &tag_name);
+	void release_opc_ua_client(const String &gateway);
+	bool reserve_opc_ua_request(const String &gateway);
+	void complete_opc_ua_request(const String &gateway, UA_Client *client);
+	int opc_ua_requests_in_flight();
+	void iterate_opc_ua_clients();
+
+	// context of an asynchronous read, deleted by its callback
+	struct OpcUaRead {
+		OIPComms *comms;
+		String gateway;
+		String tag_group_name;
+		std::shared_ptr<TagGroupSlot> slot;
+		uint64_t seq;
+		std::vector<String> tag_paths;
+	};
+	static void opc_ua_read_callback(UA_Client *client, void *userdata, UA_UInt32 request_id, UA_ReadResponse *response);
+	void complete_opc_ua_read(UA_Client *client, const OpcUaRead &read, UA_ReadResponse *response);
+	bool store_opc_ua_value(const String &tag_group_name, TagGroup &tag_group, const String &tag_path, OpcUaTag &tag, UA_DataValue &result);
+
+	OpcUaWrite *reserve_opc_ua_write(const String &gateway, const String &tag_group_name, const String &tag_path);
+	void release_opc_ua_write(OpcUaWrite &write, UA_Client *client);
+	static void opc_ua_write_callback(UA_Client *client, void *userdata, UA_UInt32 request_id, UA_WriteResponse *response);
 
 	void queue_tag_group(const String &tag_group_name);
+	void queue_write(const WriteRequest &write_req);
 
 	void flush_all_writes();
 	void flush_one_write();
@@ -123,9 +634,15 @@ private:
 	void process_write(const WriteRequest &write_req);
 
 	// process individual PLC read
-	bool process_plc_read(PlcTag &tag, const String &tag_name);
+	bool process_plc_read(const String &tag_group_name, TagGroup &tag_group, PlcTag &tag, const String &tag_name);
+	void plc_stamp(TagGroup &tag_group, PlcTag &tag, uint64_t received_usec);
 
+	int plc_timeout(const TagGroup &tag_group);
+	void plc_rtt_sample(const TagGroup &tag_group, uint64_t start_usec, int status);
+
+	bool opc_ua_write_ready(const String &tag_group_name, const String &tag_path);
 	void opc_write(const String &tag_group_name, const String &tag_path);
+	void opc_write_array(const WriteRequest &write_req);
 
 #define OIP_DECLARE_OPC_SET(a)void opc_tag_set_##a(const String &tag_group_name, const String &tag_path, const godot::Variant value);
 
@@ -141,17 +658,40 @@ private:
 	OIP_DECLARE_OPC_SET(float64)
 	OIP_DECLARE_OPC_SET(float32)
 
+	// polled values and writes go to the recorder while a recording runs
+	OIPRecorder recorder;
+
+	// spans of the worker, watchdog, tick and main threads while profiling is enabled
+	OIPProfiler profiler;
+
+	uint32_t plc_trace_id(const String &tag_group_name, TagGroup &tag_group, const String &tag_name, PlcTag &tag);
+	void record_opc_ua_value(const String &tag_group_name, const String &tag_path, OpcUaTag &tag);
+	void record_write(const WriteRequest &write_req);
+
 	void cleanup_tag_groups();
 	void cleanup_tag_group(const String &tag_group_name);
 
+	// messages of every thread go through the logger and are printed on the main thread
+	OIPLogger logger;
+	std::thread::id main_thread_id;
+	uint64_t logged_drops = 0;
+
 	void print(const Variant &message, bool error = false);
+	void print(const Variant &message, OIPLogger::Level level);
+
+	// for the worker: format is a static string filled in with the arguments on the main thread
+	void print_format(OIPLogger::Level level, const char *format, const Variant &arg0 = Variant(), const Variant &arg1 = Variant(), const Variant &arg2 = Variant(), const char *code = nullptr);
+	void flush_log();
 
 protected:
 	static void _bind_methods();
 
 public:
-	void register_tag_group(const String p_tag_group_name, const int p_polling_interval, const String p_protocol, const String p_gateway, const String p_path, const String p_cpu);
-	bool register_tag(const String p_tag_group_name, const String p_tag_name, const int p_elem_count);
+	void register_tag_group(const String p_tag_group_name, const int p_polling_interval, const String p_protocol, const String p_gateway, const String p_path, const String p_cpu, const int p_timeout = 0);
+	bool register_tag(const String p_tag_group_name, const String p_tag_name, const int p_elem_count, const double p_deadband = 0.0, const double p_deadband_percent = 0.0, const String p_type = "");
+	bool register_udt_tag(const String p_tag_group_name, const String p_tag_name, const Array p_fields);
+	bool register_bit_field(const String p_tag_group_name, const String p_tag_name, const int p_elem_count);
+	bool register_array_tag(const String p_tag_group_name, const String p_tag_name, const String p_index_range = "");
 
 	bool get_enable_comms();
 	void set_enable_comms(bool value);
@@ -164,8 +704,44 @@ public:
 
 	String get_comms_error();
 
+	Dictionary get_gateway_stats();
+
+	int64_t get_tag_age_usec(const String p_tag_group_name, const String p_tag_name);
+	Dictionary get_tag_timestamps(const String p_tag_group_name, const String p_tag_name);
+
+	void set_demand_polling(const int p_window);
+	int get_demand_polling();
+	Dictionary get_demand_polling_stats();
+
+	void set_adaptive_polling(const String p_tag_group_name, const int p_max_polling_interval);
+	int get_polling_interval(const String p_tag_group_name);
+
+	void set_stall_threshold(const int p_threshold);
+	int get_stall_threshold();
+
+	void set_abort_stalled(const bool p_abort);
+	bool get_abort_stalled();
+
+	void set_process_clock(const String p_clock);
+	String get_process_clock();
+
+	void set_fixed_tick_rate(const int p_rate);
+	int get_fixed_tick_rate();
+
+	void set_frame_budget_usec(const int p_budget);
+	int get_frame_budget_usec();
+	Dictionary get_main_thread_stats();
+
 	Array get_tag_groups();
 
+	bool start_recording(const String p_path);
+	void stop_recording();
+	Dictionary get_recording_stats();
+
+	void set_enable_profiling(bool value);
+	bool get_enable_profiling();
+	bool dump_profile(const String p_path);
+
 #define OIP_DECLARE_FUNC(a, b)                                          \
 	b read_##a(const String p_tag_group_name, const String p_tag_name); \
 	void write_##a(const String p_tag_group_name, const String p_tag_name, const b p_value);
@@ -182,6 +758,12 @@ public:
 	OIP_DECLARE_FUNC(float64, double)
 	OIP_DECLARE_FUNC(float32, float)
 
+	PackedByteArray read_bits(const String p_tag_group_name, const String p_tag_name);
+	Variant read_array(const String p_tag_group_name, const String p_tag_name);
+	PackedInt32Array get_array_dimensions(const String p_tag_group_name, const String p_tag_name);
+	void write_array(const String p_tag_group_name, const String p_tag_name, const Variant p_value, const String p_index_range = "");
+	Array read_udt(const String p_tag_group_name, const String p_tag_name);
+
 	void clear_tag_groups();
 
 	void process();
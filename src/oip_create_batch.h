@@ -0,0 +1,68 @@
+#ifndef OIP_CREATE_BATCH_H
+#define OIP_CREATE_BATCH_H
+
+#include "libplctag.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace godot {
+
+// Tags created together with a zero timeout plc_tag_create, so they all connect at once.
+//
+// Every poll() checks the status of each pending tag. A tag leaves the batch when it is
+// created, fails, or is still pending once the batch timed out. The status is asked from
+// the caller, which keeps this free of libplctag calls and of Godot.
+class OIPCreateBatch {
+public:
+	struct Result {
+		size_t id;
+		int32_t tag_pointer;
+		int status; // PLCTAG_STATUS_OK or the error, PLCTAG_ERR_TIMEOUT when it never finished
+	};
+
+private:
+	struct Pending {
+		size_t id;
+		int32_t tag_pointer;
+	};
+	std::vector<Pending> pending;
+
+public:
+	void add(size_t id, int32_t tag_pointer) {
+		pending.push_back({ id, tag_pointer });
+	}
+
+	bool empty() const { return pending.empty(); }
+	size_t size() const { return pending.size(); }
+
+	// status_of(tag_pointer) returns the plc_tag_status of a tag. finished tags are
+	// appended to done and removed from the batch
+	template <typename F>
+	void poll(F status_of, bool timed_out, std::vector<Result> &done) {
+		for (size_t i = 0; i < pending.size();) {
+			int status = status_of(pending[i].tag_pointer);
+			if (status == PLCTAG_STATUS_PENDING && !timed_out) {
+				i++;
+				continue;
+			}
+			if (status == PLCTAG_STATUS_PENDING)
+				status = PLCTAG_ERR_TIMEOUT;
+			done.push_back({ pending[i].id, pending[i].tag_pointer, status });
+
+			pending[i] = pending.back();
+			pending.pop_back();
+		}
+	}
+
+	// a group is ready once every one of its tags was created. a group with a failed tag
+	// stays not ready until the tag is created by a later pass
+	static bool ready(size_t created, size_t tag_count) {
+		return created >= tag_count;
+	}
+};
+
+} //namespace godot
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef OIP_DEADBAND_H
+#define OIP_DEADBAND_H
+
+#include <algorithm>
+#include <cmath>
+
+namespace godot {
+
+// analog values whose change is smaller than the deadband are neither reported
+// through tag_values_changed nor written. the larger of the two thresholds applies,
+// the percentage is taken of the last value let through
+struct OIPDeadband {
+	double absolute = 0.0;
+	double percent = 0.0;
+
+	double reported = 0.0;
+	bool has_reported = false;
+
+	double written = 0.0;
+	bool has_written = false;
+
+	bool enabled() const {
+		return absolute > 0.0 || percent > 0.0;
+	}
+
+	// true when value moved far enough from last to be let through, it then becomes the new last
+	bool exceeded(double value, double &last, bool &has_last) const {
+		if (has_last && std::abs(value - last) < std::max(absolute, std::abs(last) * percent / 100.0))
+			return false;
+		last = value;
+		has_last = true;
+		return true;
+	}
+};
+
+} //namespace godot
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef OIP_GATEWAY_RTT_H
+#define OIP_GATEWAY_RTT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace godot {
+
+// round trip times of the PLC calls to one gateway, smoothed as TCP does (RFC 6298). reads
+// and writes time out after srtt + 4 * rttvar, doubled after each timeout until the gateway
+// answers again, and never outside [MIN_TIMEOUT, timeout]
+struct OIPGatewayRtt {
+	static const int MIN_TIMEOUT = 20;
+	static const uint64_t MIN_SAMPLES = 8;
+
+	double srtt = 0.0;
+	double rttvar = 0.0;
+	uint64_t samples = 0;
+	int backoff = 1;
+
+	void sample(double rtt) {
+		if (samples == 0) {
+			srtt = rtt;
+			rttvar = rtt / 2.0;
+		} else {
+			rttvar += (std::abs(srtt - rtt) - rttvar) * 0.25;
+			srtt += (rtt - srtt) * 0.125;
+		}
+		samples++;
+		backoff = 1;
+	}
+
+	// the gateway did not answer in time
+	void back_off() {
+		backoff = std::min(backoff * 2, 64);
+	}
+
+	int timeout(int max) const {
+		if (samples < MIN_SAMPLES)
+			return max;
+		return (int)std::clamp((srtt + 4.0 * rttvar) * backoff, (double)MIN_TIMEOUT, (double)max);
+	}
+};
+
+} //namespace godot
+
+#endif
@@ -0,0 +1,122 @@
+#include "oip_logger.h"
+
+#include <utility>
+
+using namespace godot;
+
+// every slot carries the position it can be written at next, or that position + 1 once
+// written, so producers and the consumer can tell which lap of the ring a slot is on
+OIPLogger::OIPLogger() :
+		slots(RING_SIZE) {
+	for (size_t i = 0; i < RING_SIZE; i++) {
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+bool OIPLogger::push(Level level, const String &message) {
+	Slot *slot = claim();
+	if (slot == nullptr)
+		return false;
+
+	slot->entry.level = level;
+	slot->entry.message = message;
+	slot->entry.format = nullptr;
+	slot->sequence.store(slot->position + 1, std::memory_order_release);
+	return true;
+}
+
+// the arguments are copied by reference, strings and packed arrays are not duplicated here
+bool OIPLogger::push(Level level, const char *format, const Variant &arg0, const Variant &arg1, const Variant &arg2, const char *code) {
+	Slot *slot = claim();
+	if (slot == nullptr)
+		return false;
+
+	slot->entry.level = level;
+	slot->entry.format = format;
+	slot->entry.args[0] = arg0;
+	slot->entry.args[1] = arg1;
+	slot->entry.args[2] = arg2;
+	slot->entry.code = code;
+	slot->sequence.store(slot->position + 1, std::memory_order_release);
+	return true;
+}
+
+OIPLogger::Slot *OIPLogger::claim() {
+	uint64_t position = head.load(std::memory_order_relaxed);
+	Slot *slot;
+	while (true) {
+		slot = &slots[position & (RING_SIZE - 1)];
+		const int64_t lap = (int64_t)(slot->sequence.load(std::memory_order_acquire) - position);
+		if (lap == 0) {
+			if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+		} else if (lap < 0) {
+			// the main thread has not drained this slot yet
+			dropped++;
+			return nullptr;
+		} else {
+			position = head.load(std::memory_order_relaxed);
+		}
+	}
+
+	// the slot is the claiming thread's until its sequence is stored
+	slot->position = position;
+	return slot;
+}
+
+String OIPLogger::format(const Entry &entry) {
+	String message = String::utf8(entry.format);
+	for (int i = 0; i < 3; i++) {
+		if (entry.args[i].get_type() != Variant::NIL)
+			message = message.replace("{" + itos(i) + "}", String(entry.args[i]));
+	}
+	if (entry.code != nullptr)
+		message = message.replace("{code}", String::utf8(entry.code));
+	return message;
+}
+
+void OIPLogger::drain(uint64_t now_usec, std::vector<Entry> &entries) {
+	for (auto it = repeats.begin(); it != repeats.end();) {
+		const Repeat &repeat = it->second;
+		if (now_usec - repeat.window_start < REPEAT_WINDOW_USEC) {
+			++it;
+			continue;
+		}
+		if (repeat.count > 0)
+			entries.push_back({ repeat.level, it->first + " (repeated " + itos(repeat.count) + (repeat.count == 1 ? " more time" : " more times") + " in " + itos(REPEAT_WINDOW_USEC / 1000000) + " s)" });
+		it = repeats.erase(it);
+	}
+
+	while (true) {
+		Slot &slot = slots[tail & (RING_SIZE - 1)];
+		if (slot.sequence.load(std::memory_order_acquire) != tail + 1)
+			break;
+
+		Entry entry = std::move(slot.entry);
+		slot.entry.message = String();
+		for (Variant &arg : slot.entry.args) {
+			arg = Variant();
+		}
+		slot.sequence.store(tail + RING_SIZE, std::memory_order_release);
+		tail++;
+
+		if (entry.format != nullptr) {
+			entry.message = format(entry);
+			entry.format = nullptr;
+		}
+
+		if (entry.level != LEVEL_INFO) {
+			auto repeat_it = repeats.find(entry.message);
+			if (repeat_it != repeats.end()) {
+				repeat_it->second.count++;
+				continue;
+			}
+			repeats[entry.message] = { entry.level, now_usec, 0 };
+		}
+		entries.push_back(std::move(entry));
+	}
+}
+
+uint64_t OIPLogger::get_dropped() const {
+	return dropped.load();
+}
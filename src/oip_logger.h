@@ -0,0 +1,86 @@
+#ifndef OIP_LOGGER_H
+#define OIP_LOGGER_H
+
+#include <godot_cpp/variant/string.hpp>
+#include <godot_cpp/variant/variant.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace godot {
+
+// Carries log messages from any thread to the main thread, which prints them.
+//
+// Messages go into a fixed ring of slots allocated up front, claimed with a compare and
+// swap, so a thread logging never waits on a lock or on the console. Worker threads push a
+// static format and its arguments rather than text, the main thread formats them in drain(),
+// so logging there doesn't build strings either. A full ring drops the
+// message and counts it. The main thread drains the ring and folds repeats of a warning or
+// error together: the first one is passed on right away, the rest of the window only
+// counts, and a single summary follows once the window is over.
+class OIPLogger {
+public:
+	enum Level {
+		LEVEL_INFO,
+		LEVEL_WARNING,
+		LEVEL_ERROR,
+	};
+
+	struct Entry {
+		Level level = LEVEL_INFO;
+		String message;
+
+		// static format the message is built from on the main thread, null when the message
+		// was formatted by the caller. "{0}" to "{2}" take the arguments, "{code}" the name
+		// of a status code, a static string as well
+		const char *format = nullptr;
+		Variant args[3];
+		const char *code = nullptr;
+	};
+
+	static const size_t RING_SIZE = 4096;
+	static const uint64_t REPEAT_WINDOW_USEC = 10000000;
+
+private:
+	struct Slot {
+		std::atomic<uint64_t> sequence{ 0 };
+		uint64_t position = 0;
+		Entry entry;
+	};
+
+	std::vector<Slot> slots;
+	std::atomic<uint64_t> head{ 0 };
+	uint64_t tail = 0;
+	std::atomic<uint64_t> dropped{ 0 };
+
+	// warnings and errors seen within their window, main thread only
+	struct Repeat {
+		Level level;
+		uint64_t window_start;
+		uint64_t count; // repeats after the first one, which was already passed on
+	};
+	std::map<String, Repeat> repeats;
+
+	// a free slot for the calling thread, null when the ring is full
+	Slot *claim();
+	static String format(const Entry &entry);
+
+public:
+	OIPLogger();
+
+	// any thread
+	bool push(Level level, const String &message);
+	bool push(Level level, const char *format, const Variant &arg0, const Variant &arg1, const Variant &arg2, const char *code);
+
+	// main thread: the entries to print now, formatted and in order, with the summaries of
+	// the repeats whose window ended
+	void drain(uint64_t now_usec, std::vector<Entry> &entries);
+
+	uint64_t get_dropped() const;
+};
+
+} //namespace godot
+
+#endif
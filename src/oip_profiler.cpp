@@ -0,0 +1,138 @@
+#include "oip_profiler.h"
+
+#include <godot_cpp/classes/file_access.hpp>
+#include <godot_cpp/classes/time.hpp>
+
+using namespace godot;
+
+// the ring of the current thread, valid while instance matches the profiler it came from
+struct OIPProfilerThread {
+	uint64_t instance = 0;
+	void *ring = nullptr;
+};
+static thread_local OIPProfilerThread oip_profiler_thread;
+
+static std::atomic<uint64_t> oip_profiler_instances{ 0 };
+
+OIPProfiler::OIPProfiler() :
+		instance(++oip_profiler_instances) {
+}
+
+OIPProfiler::Scope::Scope(OIPProfiler &p_profiler, const char *p_name, const String &p_detail) :
+		profiler(p_profiler), name(p_name) {
+	if (profiler.is_enabled()) {
+		detail = p_detail;
+		start_usec = Time::get_singleton()->get_ticks_usec();
+	}
+}
+
+OIPProfiler::Scope::~Scope() {
+	// a span which started before profiling was enabled is not recorded
+	if (start_usec != 0)
+		profiler.record(name, detail, start_usec, Time::get_singleton()->get_ticks_usec());
+}
+
+OIPProfiler::Ring *OIPProfiler::thread_ring() {
+	if (oip_profiler_thread.instance == instance)
+		return (Ring *)oip_profiler_thread.ring;
+
+	// the spans themselves are only allocated by the first record(), a thread which is just
+	// named costs nothing while profiling stays off
+	std::unique_ptr<Ring> ring = std::make_unique<Ring>();
+
+	std::lock_guard<std::mutex> lock(rings_mutex);
+	ring->thread_name = "Thread " + itos(rings.size());
+	rings.push_back(std::move(ring));
+	oip_profiler_thread.instance = instance;
+	oip_profiler_thread.ring = rings.back().get();
+	return rings.back().get();
+}
+
+void OIPProfiler::set_enabled(bool p_enabled) {
+	enabled = p_enabled;
+}
+
+bool OIPProfiler::is_enabled() const {
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void OIPProfiler::name_thread(const String &thread_name) {
+	Ring *ring = thread_ring();
+	std::lock_guard<std::mutex> lock(rings_mutex);
+	ring->thread_name = thread_name;
+}
+
+void OIPProfiler::record(const char *name, const String &detail, uint64_t start_usec, uint64_t end_usec, bool async) {
+	if (!is_enabled())
+		return;
+
+	Ring *ring = thread_ring();
+
+	// published to dump() along with the first head below
+	if (ring->spans.empty())
+		ring->spans.resize(RING_SIZE);
+
+	const uint64_t position = ring->head.load(std::memory_order_relaxed);
+	if (position - ring->tail.load(std::memory_order_acquire) >= RING_SIZE) {
+		dropped++;
+		return;
+	}
+
+	Span &span = ring->spans[position & (RING_SIZE - 1)];
+	span.name = name;
+	span.detail = detail;
+	span.start_usec = start_usec;
+	span.end_usec = end_usec;
+	span.async = async;
+	ring->head.store(position + 1, std::memory_order_release);
+}
+
+// complete events ("X") for nested spans, async begin/end pairs for overlapping ones
+bool OIPProfiler::dump(const String &path, String &error) {
+	Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE);
+	if (file.is_null()) {
+		error = "could not be opened for writing";
+		return false;
+	}
+
+	file->store_string("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	bool first = true;
+	uint64_t async_id = 0;
+
+	std::lock_guard<std::mutex> lock(rings_mutex);
+	for (size_t tid = 0; tid < rings.size(); tid++) {
+		Ring &ring = *rings[tid];
+		const String thread = "\"pid\":1,\"tid\":" + itos(tid);
+
+		file->store_string(String(first ? "" : ",\n") + "{\"name\":\"thread_name\",\"ph\":\"M\"," + thread + ",\"args\":{\"name\":\"" + ring.thread_name.json_escape() + "\"}}");
+		first = false;
+
+		const uint64_t end = ring.head.load(std::memory_order_acquire);
+		uint64_t position = ring.tail.load(std::memory_order_relaxed);
+		for (; position < end; position++) {
+			Span &span = ring.spans[position & (RING_SIZE - 1)];
+			const String name = "\"name\":\"" + String(span.name) + "\",\"cat\":\"oip\"," + thread;
+			const String args = span.detail.is_empty() ? String() : ",\"args\":{\"detail\":\"" + span.detail.json_escape() + "\"}";
+
+			if (span.async) {
+				const String id = ",\"id\":" + itos(++async_id);
+				file->store_string(",\n{" + name + ",\"ph\":\"b\",\"ts\":" + itos(span.start_usec) + id + args + "}");
+				file->store_string(",\n{" + name + ",\"ph\":\"e\",\"ts\":" + itos(span.end_usec) + id + "}");
+			} else {
+				file->store_string(",\n{" + name + ",\"ph\":\"X\",\"ts\":" + itos(span.start_usec) + ",\"dur\":" + itos(span.end_usec - span.start_usec) + args + "}");
+			}
+
+			// drop the reference now, the slot may not be written again for a while
+			span.detail = String();
+		}
+		ring.tail.store(position, std::memory_order_release);
+	}
+
+	file->store_string("\n]}\n");
+	file->close();
+	return true;
+}
+
+uint64_t OIPProfiler::get_dropped() const {
+	return dropped.load();
+}
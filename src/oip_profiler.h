@@ -0,0 +1,88 @@
+#ifndef OIP_PROFILER_H
+#define OIP_PROFILER_H
+
+#include <godot_cpp/variant/string.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace godot {
+
+// Collects timed spans of the comms threads and writes them out as Chrome trace events,
+// which chrome://tracing and Perfetto (ui.perfetto.dev) open directly.
+//
+// Every thread which records gets a ring of its own on its first span, so recording never
+// takes a lock: the thread is the only producer of its ring and dump() the only consumer.
+// Naming a thread only keeps its name, the ring's spans are allocated when it records.
+// A full ring drops new spans and counts them. Timestamps are Time::get_ticks_usec, the
+// clock of Godot's own profiler.
+class OIPProfiler {
+public:
+	struct Span {
+		// static strings, only the pointer is stored
+		const char *name;
+		String detail;
+
+		uint64_t start_usec;
+		uint64_t end_usec;
+
+		// spans which overlap others on the same thread, like tags created concurrently
+		bool async;
+	};
+
+private:
+	struct Ring {
+		String thread_name;
+		std::vector<Span> spans;
+		std::atomic<uint64_t> head{ 0 };
+		std::atomic<uint64_t> tail{ 0 };
+	};
+
+	std::atomic<bool> enabled{ false };
+	std::atomic<uint64_t> dropped{ 0 };
+
+	// rings are only ever added, and live as long as the profiler
+	std::vector<std::unique_ptr<Ring>> rings;
+	std::mutex rings_mutex;
+	const uint64_t instance;
+
+	Ring *thread_ring();
+
+public:
+	// spans kept per thread until the next dump
+	static const size_t RING_SIZE = 1 << 16;
+
+	// records the lifetime of the scope as a span, when profiling is enabled
+	class Scope {
+		OIPProfiler &profiler;
+		const char *name;
+		String detail;
+		uint64_t start_usec = 0;
+
+	public:
+		Scope(OIPProfiler &p_profiler, const char *p_name, const String &p_detail = String());
+		~Scope();
+	};
+
+	OIPProfiler();
+
+	void set_enabled(bool p_enabled);
+	bool is_enabled() const;
+
+	// names the calling thread in the trace
+	void name_thread(const String &thread_name);
+
+	void record(const char *name, const String &detail, uint64_t start_usec, uint64_t end_usec, bool async = false);
+
+	// moves every span recorded so far into a trace file
+	bool dump(const String &path, String &error);
+
+	uint64_t get_dropped() const;
+};
+
+} //namespace godot
+
+#endif
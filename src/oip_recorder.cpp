@@ -0,0 +1,396 @@
+#include "oip_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace godot;
+
+// the file grows and is mapped in windows of this size, a multiple of the 64 KiB
+// allocation granularity on Windows and of the page size everywhere else
+static const uint64_t WINDOW_SIZE = 16 * 1024 * 1024;
+
+static uint64_t oip_recorder_ticks_usec() {
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+OIPRecorder::~OIPRecorder() {
+	stop();
+}
+
+bool OIPRecorder::start(const std::string &path, size_t ring_size) {
+	stop();
+
+	size_t capacity = 1024;
+	while (capacity < ring_size)
+		capacity <<= 1;
+	ring.assign(capacity, 0);
+	ring_mask = capacity - 1;
+
+	if (!open_file(path))
+		return false;
+
+	uint8_t file_header[FILE_HEADER_SIZE] = { 'O', 'I', 'P', 'T', 'R', 'A', 'C', 'E' };
+	uint32_t version = VERSION;
+	memcpy(file_header + 8, &version, sizeof(version));
+	if (!append(file_header, FILE_HEADER_SIZE)) {
+		close_file();
+		return false;
+	}
+
+	head = 0;
+	tail = 0;
+	failed = false;
+	records = 0;
+	dropped = 0;
+	bytes_written = FILE_HEADER_SIZE;
+	next_tag_id = 0;
+	start_ticks = oip_recorder_ticks_usec();
+	session++;
+
+	writer_running = true;
+	writer_thread = std::thread(&OIPRecorder::write_thread, this);
+	recording = true;
+	return true;
+}
+
+void OIPRecorder::stop() {
+	if (!writer_thread.joinable())
+		return;
+
+	// wait for a record() or define_*() in progress on the producer thread before draining the ring
+	recording = false;
+	while (producers.load() > 0)
+		std::this_thread::yield();
+
+	writer_running = false;
+	writer_thread.join();
+	close_file();
+	failed = false;
+}
+
+bool OIPRecorder::is_recording() const {
+	return recording.load();
+}
+
+bool OIPRecorder::has_failed() const {
+	return failed.load();
+}
+
+uint32_t OIPRecorder::get_session() const {
+	return session.load();
+}
+
+// ids are handed out under the same guard as record(), so start() never resets the counter
+// while one is being defined. none are handed out while stopped
+uint32_t OIPRecorder::define_tag(const std::string &tag_group_name, const std::string &tag_name) {
+	producers++;
+	uint32_t tag_id = 0;
+	if (recording.load()) {
+		tag_id = next_tag_id++;
+		const std::string names = tag_group_name + '\0' + tag_name;
+		record(RECORD_TAG, tag_id, 0, (const uint8_t *)names.data(), names.size());
+	}
+	producers--;
+	return tag_id;
+}
+
+uint32_t OIPRecorder::define_member(const std::string &tag_group_name, const std::string &tag_name, uint32_t owner_id, int32_t offset, int32_t bit) {
+	producers++;
+	uint32_t tag_id = 0;
+	if (recording.load()) {
+		tag_id = next_tag_id++;
+		const std::string names = tag_group_name + '\0' + tag_name;
+		std::vector<uint8_t> payload(MEMBER_HEADER_SIZE + names.size());
+		memcpy(payload.data(), &owner_id, 4);
+		memcpy(payload.data() + 4, &offset, 4);
+		memcpy(payload.data() + 8, &bit, 4);
+		memcpy(payload.data() + MEMBER_HEADER_SIZE, names.data(), names.size());
+		record(RECORD_MEMBER, tag_id, 0, payload.data(), payload.size());
+	}
+	producers--;
+	return tag_id;
+}
+
+void OIPRecorder::record(RecordKind kind, uint32_t tag_id, uint8_t type, const uint8_t *data, size_t size) {
+	producers++;
+	if (recording.load()) {
+		if (size > UINT16_MAX) {
+			dropped++;
+		} else {
+			RecordHeader header = { (uint16_t)size, kind, type, tag_id, oip_recorder_ticks_usec() - start_ticks };
+			push(header, data, size);
+		}
+	}
+	producers--;
+}
+
+void OIPRecorder::push(const RecordHeader &header, const uint8_t *payload, size_t size) {
+	const size_t total = sizeof(RecordHeader) + size;
+	const uint64_t position = head.load(std::memory_order_relaxed);
+	if (ring.size() - (position - tail.load(std::memory_order_acquire)) < total) {
+		dropped++;
+		return;
+	}
+
+	copy_in(position, (const uint8_t *)&header, sizeof(RecordHeader));
+	copy_in(position + sizeof(RecordHeader), payload, size);
+	head.store(position + total, std::memory_order_release);
+	records++;
+}
+
+void OIPRecorder::copy_in(uint64_t position, const uint8_t *data, size_t size) {
+	size_t index = position & ring_mask;
+	size_t first = std::min(size, ring.size() - index);
+	memcpy(ring.data() + index, data, first);
+	if (size > first)
+		memcpy(ring.data(), data + first, size - first);
+}
+
+void OIPRecorder::copy_out(uint64_t position, uint8_t *data, size_t size) const {
+	size_t index = position & ring_mask;
+	size_t first = std::min(size, ring.size() - index);
+	memcpy(data, ring.data() + index, first);
+	if (size > first)
+		memcpy(data + first, ring.data(), size - first);
+}
+
+// head only ever moves by whole records, so everything written up to a head is a whole
+// number of records. the ring is released up to it once both pieces of a wrapped run are in
+void OIPRecorder::write_thread() {
+	while (true) {
+		const uint64_t position = tail.load(std::memory_order_relaxed);
+		const uint64_t end = head.load(std::memory_order_acquire);
+		if (position == end) {
+			// the producer is gone once writer_running drops, so an empty ring means done
+			if (!writer_running.load())
+				break;
+			std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			continue;
+		}
+
+		const uint64_t whole_length = file_length;
+		const size_t index = position & ring_mask;
+		const size_t size = (size_t)(end - position);
+		const size_t first = std::min(size, ring.size() - index);
+		if (!append(ring.data() + index, first) || !append(ring.data(), size - first)) {
+			file_length = whole_length;
+			drop_unwritten(position);
+			break;
+		}
+		bytes_written += size;
+		tail.store(end, std::memory_order_release);
+	}
+}
+
+// the file could not take any more. recording stops, and the records from position on,
+// along with any still being pushed, are counted as dropped instead of written
+void OIPRecorder::drop_unwritten(uint64_t position) {
+	recording = false;
+	while (producers.load() > 0)
+		std::this_thread::yield();
+
+	const uint64_t end = head.load(std::memory_order_acquire);
+	uint64_t lost = 0;
+	while (position < end) {
+		RecordHeader header;
+		copy_out(position, (uint8_t *)&header, sizeof(header));
+		position += sizeof(header) + header.size;
+		lost++;
+	}
+	records -= lost;
+	dropped += lost;
+	tail.store(end, std::memory_order_release);
+	failed = true;
+}
+
+bool OIPRecorder::append(const uint8_t *data, size_t size) {
+	while (size > 0) {
+		if (window == nullptr || file_length >= window_offset + WINDOW_SIZE) {
+			if (!map_window(file_length - file_length % WINDOW_SIZE))
+				return false;
+		}
+
+		size_t count = (size_t)std::min<uint64_t>(size, window_offset + WINDOW_SIZE - file_length);
+		memcpy(window + (file_length - window_offset), data, count);
+		file_length += count;
+		data += count;
+		size -= count;
+	}
+	return true;
+}
+
+#ifdef _WIN32
+
+bool OIPRecorder::open_file(const std::string &path) {
+	const int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+	std::wstring wide_path(std::max(length, 1), L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &wide_path[0], length);
+	file_handle = CreateFileW(wide_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		file_handle = nullptr;
+		return false;
+	}
+	file_length = 0;
+	return true;
+}
+
+bool OIPRecorder::map_window(uint64_t offset) {
+	unmap_window();
+
+	// a mapping larger than the file extends it
+	uint64_t size = offset + WINDOW_SIZE;
+	mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_READWRITE, (DWORD)(size >> 32), (DWORD)size, nullptr);
+	if (mapping_handle == nullptr)
+		return false;
+
+	window = (uint8_t *)MapViewOfFile(mapping_handle, FILE_MAP_WRITE, (DWORD)(offset >> 32), (DWORD)offset, WINDOW_SIZE);
+	if (window == nullptr) {
+		CloseHandle(mapping_handle);
+		mapping_handle = nullptr;
+		return false;
+	}
+	window_offset = offset;
+	return true;
+}
+
+void OIPRecorder::unmap_window() {
+	if (window != nullptr) {
+		UnmapViewOfFile(window);
+		window = nullptr;
+	}
+	if (mapping_handle != nullptr) {
+		CloseHandle(mapping_handle);
+		mapping_handle = nullptr;
+	}
+}
+
+void OIPRecorder::close_file() {
+	unmap_window();
+	if (file_handle != nullptr) {
+		// drop the unused tail of the last window
+		LARGE_INTEGER length;
+		length.QuadPart = (LONGLONG)file_length;
+		SetFilePointerEx(file_handle, length, nullptr, FILE_BEGIN);
+		SetEndOfFile(file_handle);
+		CloseHandle(file_handle);
+		file_handle = nullptr;
+	}
+}
+
+#else
+
+bool OIPRecorder::open_file(const std::string &path) {
+	file_descriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	file_length = 0;
+	return file_descriptor >= 0;
+}
+
+bool OIPRecorder::map_window(uint64_t offset) {
+	unmap_window();
+
+	if (ftruncate(file_descriptor, (off_t)(offset + WINDOW_SIZE)) != 0)
+		return false;
+
+	void *address = mmap(nullptr, WINDOW_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, file_descriptor, (off_t)offset);
+	if (address == MAP_FAILED)
+		return false;
+
+	window = (uint8_t *)address;
+	window_offset = offset;
+	return true;
+}
+
+void OIPRecorder::unmap_window() {
+	if (window != nullptr) {
+		munmap(window, WINDOW_SIZE);
+		window = nullptr;
+	}
+}
+
+void OIPRecorder::close_file() {
+	unmap_window();
+	if (file_descriptor >= 0) {
+		// drop the unused tail of the last window, on failure the file keeps trailing zeros
+		int result = ftruncate(file_descriptor, (off_t)file_length);
+		(void)result;
+		close(file_descriptor);
+		file_descriptor = -1;
+	}
+}
+
+#endif
+
+uint64_t OIPRecorder::get_records() const {
+	return records.load();
+}
+
+uint64_t OIPRecorder::get_dropped() const {
+	return dropped.load();
+}
+
+uint64_t OIPRecorder::get_bytes_written() const {
+	return bytes_written.load();
+}
+
+OIPTraceReader::OIPTraceReader(const uint8_t *p_data, size_t p_size) :
+		data(p_data), size(p_size), position(OIPRecorder::FILE_HEADER_SIZE) {
+}
+
+bool OIPTraceReader::is_valid() const {
+	if (size < OIPRecorder::FILE_HEADER_SIZE || memcmp(data, "OIPTRACE", 8) != 0)
+		return false;
+	uint32_t version;
+	memcpy(&version, data + 8, sizeof(version));
+	return version == OIPRecorder::VERSION;
+}
+
+bool OIPTraceReader::next(Record &record) {
+	if (!is_valid() || position + sizeof(OIPRecorder::RecordHeader) > size)
+		return false;
+
+	memcpy(&record.header, data + position, sizeof(record.header));
+	const size_t payload = position + sizeof(record.header);
+	if (payload + record.header.size > size)
+		return false;
+	record.payload = data + payload;
+
+	const uint8_t kind = record.header.kind;
+	if (kind == OIPRecorder::RECORD_TAG || kind == OIPRecorder::RECORD_MEMBER) {
+		const size_t names_start = kind == OIPRecorder::RECORD_MEMBER ? OIPRecorder::MEMBER_HEADER_SIZE : 0;
+		if (record.header.size < names_start)
+			return false;
+		const char *names = (const char *)record.payload + names_start;
+		const size_t names_size = record.header.size - names_start;
+		const size_t separator = std::find(names, names + names_size, '\0') - names;
+
+		// a recording which was not closed cleanly ends in zeros
+		if (separator == 0 || separator >= names_size)
+			return false;
+
+		record.tag_group_name.assign(names, separator);
+		record.tag_name.assign(names + separator + 1, names_size - separator - 1);
+		if (kind == OIPRecorder::RECORD_MEMBER) {
+			memcpy(&record.owner_id, record.payload, 4);
+			memcpy(&record.offset, record.payload + 4, 4);
+			memcpy(&record.bit, record.payload + 8, 4);
+		}
+	}
+
+	position = payload + record.header.size;
+	return true;
+}
@@ -0,0 +1,161 @@
+#ifndef OIP_RECORDER_H
+#define OIP_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace godot {
+
+// Records polled values and writes into a compact append-only binary log.
+//
+// File layout: a 16 byte header ("OIPTRACE", uint32 version, uint32 reserved), then
+// records of a RecordHeader followed by size bytes of payload, all little endian.
+// RECORD_TAG payload is "group\0tag"; RECORD_MEMBER payload is uint32 owner id,
+// int32 byte offset, int32 bit, then "group\0tag"; RECORD_POLL and RECORD_WRITE
+// payloads are the raw value bytes.
+//
+// Records are pushed into a fixed size ring by a single producer (the comms worker)
+// without locking, and a background thread drains the ring into a memory mapped file.
+// When the ring is full, records are dropped and counted instead of blocking.
+//
+// Paths and names are utf8, the recorder does not depend on Godot.
+class OIPRecorder {
+public:
+	enum RecordKind : uint8_t {
+		RECORD_TAG = 0,
+		RECORD_POLL = 1,
+		RECORD_WRITE = 2,
+		RECORD_MEMBER = 3,
+	};
+
+	// value types: 0-10 follow WriteRequest::instruction, OPC UA values are TYPE_OPC_UA
+	// plus the UA_DataTypeKind, a PLC tag buffer is TYPE_RAW
+	static const uint8_t TYPE_OPC_UA = 0x80;
+	static const uint8_t TYPE_RAW = 0xFF;
+
+	static const uint32_t VERSION = 1;
+	static const size_t FILE_HEADER_SIZE = 16;
+	static const size_t MEMBER_HEADER_SIZE = 12;
+
+#pragma pack(push, 1)
+	struct RecordHeader {
+		uint16_t size;
+		uint8_t kind;
+		uint8_t type;
+		uint32_t tag_id;
+
+		// microseconds since the recording started
+		uint64_t timestamp;
+	};
+#pragma pack(pop)
+
+private:
+	std::vector<uint8_t> ring;
+	size_t ring_mask = 0;
+
+	// free running byte counters, head is only written by the producer, tail by the writer thread
+	std::atomic<uint64_t> head{ 0 };
+	std::atomic<uint64_t> tail{ 0 };
+
+	std::atomic<bool> recording{ false };
+	std::atomic<int> producers{ 0 };
+	std::atomic<uint32_t> session{ 0 };
+	std::atomic<uint32_t> next_tag_id{ 0 };
+	uint64_t start_ticks = 0;
+
+	// set by the writer thread when the file could not be extended, recording stops then
+	std::atomic<bool> failed{ false };
+
+	std::atomic<uint64_t> records{ 0 };
+	std::atomic<uint64_t> dropped{ 0 };
+	std::atomic<uint64_t> bytes_written{ 0 };
+
+	std::thread writer_thread;
+	std::atomic<bool> writer_running{ false };
+
+	// memory mapped file, extended and remapped one window at a time
+#ifdef _WIN32
+	void *file_handle = nullptr;
+	void *mapping_handle = nullptr;
+#else
+	int file_descriptor = -1;
+#endif
+	uint8_t *window = nullptr;
+	uint64_t window_offset = 0;
+	uint64_t file_length = 0;
+
+	bool open_file(const std::string &path);
+	bool map_window(uint64_t offset);
+	void unmap_window();
+	void close_file();
+	bool append(const uint8_t *data, size_t size);
+
+	void push(const RecordHeader &header, const uint8_t *payload, size_t size);
+	void copy_in(uint64_t position, const uint8_t *data, size_t size);
+	void copy_out(uint64_t position, uint8_t *data, size_t size) const;
+	void drop_unwritten(uint64_t position);
+	void write_thread();
+
+public:
+	bool start(const std::string &path, size_t ring_size);
+	void stop();
+
+	bool is_recording() const;
+
+	// true once writing to the file failed. the records which did not make it are counted
+	// as dropped and the file ends at the last whole record; stop() closes it
+	bool has_failed() const;
+
+	// changes on every start, tag ids handed out by an older session are stale
+	uint32_t get_session() const;
+
+	// the methods below may only be called from the producer thread
+	uint32_t define_tag(const std::string &tag_group_name, const std::string &tag_name);
+	uint32_t define_member(const std::string &tag_group_name, const std::string &tag_name, uint32_t owner_id, int32_t offset, int32_t bit);
+	void record(RecordKind kind, uint32_t tag_id, uint8_t type, const uint8_t *data, size_t size);
+
+	uint64_t get_records() const;
+	uint64_t get_dropped() const;
+	uint64_t get_bytes_written() const;
+
+	~OIPRecorder();
+};
+
+// Walks the records of a trace written by OIPRecorder. Reading stops at the end of the
+// data, at a record cut short, or at the zeros a recording which was not closed ends in.
+class OIPTraceReader {
+public:
+	struct Record {
+		OIPRecorder::RecordHeader header;
+		const uint8_t *payload = nullptr;
+
+		// RECORD_TAG and RECORD_MEMBER
+		std::string tag_group_name;
+		std::string tag_name;
+
+		// RECORD_MEMBER
+		uint32_t owner_id = 0;
+		int32_t offset = 0;
+		int32_t bit = -1;
+	};
+
+private:
+	const uint8_t *data;
+	size_t size;
+	size_t position;
+
+public:
+	OIPTraceReader(const uint8_t *p_data, size_t p_size);
+
+	// false when the data does not start with the header of a trace of this version
+	bool is_valid() const;
+
+	bool next(Record &record);
+};
+
+} //namespace godot
+
+#endif
@@ -0,0 +1,138 @@
+#include "oip_replay.h"
+#include "oip_recorder.h"
+
+#include <godot_cpp/classes/file_access.hpp>
+
+using namespace godot;
+
+bool OIPReplay::load(const String &path, const String &tag_group_name, String &error) {
+	file = FileAccess::get_file_as_bytes(path);
+	if (file.is_empty()) {
+		error = "could not be read";
+		return false;
+	}
+
+	OIPTraceReader reader(file.ptr(), file.size());
+	if (!reader.is_valid()) {
+		error = "not a trace file";
+		return false;
+	}
+
+	// only tags of the group are kept, polls of the others are skipped
+	const std::string group = tag_group_name.utf8().get_data();
+	std::vector<bool> in_group;
+
+	OIPTraceReader::Record record;
+	while (reader.next(record)) {
+		const OIPRecorder::RecordHeader &header = record.header;
+		if (header.kind == OIPRecorder::RECORD_TAG || header.kind == OIPRecorder::RECORD_MEMBER) {
+			if (header.tag_id >= in_group.size()) {
+				in_group.resize(header.tag_id + 1, false);
+				streams.resize(header.tag_id + 1);
+			}
+			if (record.tag_group_name == group) {
+				in_group[header.tag_id] = true;
+
+				Source source;
+				source.stream = header.tag_id;
+				if (header.kind == OIPRecorder::RECORD_MEMBER) {
+					source.stream = record.owner_id;
+					source.offset = record.offset;
+					source.bit = record.bit;
+				}
+				sources[String::utf8(record.tag_name.data(), record.tag_name.size())] = source;
+			}
+
+		} else if (header.kind == OIPRecorder::RECORD_POLL) {
+			if (header.tag_id < in_group.size() && in_group[header.tag_id]) {
+				events.push_back({ header.timestamp, header.tag_id, header.size, (size_t)(record.payload - file.ptr()) });
+				duration = header.timestamp;
+			}
+		}
+	}
+
+	if (events.empty()) {
+		error = "no values recorded for tag group " + tag_group_name;
+		return false;
+	}
+
+	// timestamps count from the start of the recording, not from the first poll of this group
+	const uint64_t first = events.front().timestamp;
+	for (Event &event : events) {
+		event.timestamp -= first;
+	}
+	duration -= first;
+
+	loaded = true;
+	return true;
+}
+
+bool OIPReplay::is_loaded() const {
+	return loaded;
+}
+
+void OIPReplay::set_speed(double p_speed) {
+	speed = p_speed > 0.0 ? p_speed : 1.0;
+}
+
+bool OIPReplay::find(const String &tag_name, Source &source) const {
+	auto source_it = sources.find(tag_name);
+	if (source_it == sources.end())
+		return false;
+	source = source_it->second;
+	return true;
+}
+
+void OIPReplay::advance(uint64_t ticks_usec) {
+	if (!started) {
+		start_ticks = ticks_usec;
+		started = true;
+	}
+
+	const uint64_t elapsed = (uint64_t)((ticks_usec - start_ticks) * speed);
+	const uint64_t elapsed_cycle = elapsed / (duration + 1);
+	const uint64_t target = elapsed % (duration + 1);
+
+	// looping leaves every value as it was until the first polls overwrite it
+	if (elapsed_cycle != cycle) {
+		while (cursor < events.size()) {
+			const Event &event = events[cursor++];
+			streams[event.stream] = { file.ptr() + event.position, event.size };
+		}
+		cycle = elapsed_cycle;
+		cursor = 0;
+	}
+
+	const uint8_t *data = file.ptr();
+	while (cursor < events.size() && events[cursor].timestamp <= target) {
+		const Event &event = events[cursor++];
+		streams[event.stream] = { data + event.position, event.size };
+	}
+}
+
+bool OIPReplay::get_value(const Source &source, std::vector<uint8_t> &value) const {
+	if (source.stream >= streams.size())
+		return false;
+
+	const Stream &stream = streams[source.stream];
+	if (stream.data == nullptr || source.offset < 0 || (size_t)source.offset >= stream.size)
+		return false;
+
+	if (source.bit >= 0) {
+		const size_t byte = source.offset + source.bit / 8;
+		if (byte >= stream.size)
+			return false;
+		value.assign(1, (stream.data[byte] >> (source.bit % 8)) & 1);
+	} else {
+		value.assign(stream.data + source.offset, stream.data + stream.size);
+	}
+	return true;
+}
+
+uint64_t OIPReplay::get_duration() const {
+	return duration;
+}
+
+size_t OIPReplay::get_event_count() const {
+	return events.size();
+}
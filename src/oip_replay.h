@@ -0,0 +1,75 @@
+#ifndef OIP_REPLAY_H
+#define OIP_REPLAY_H
+
+#include <godot_cpp/variant/packed_byte_array.hpp>
+#include <godot_cpp/variant/string.hpp>
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace godot {
+
+// Plays back the polled values of one tag group out of a trace written by OIPRecorder.
+//
+// The whole file is loaded once and the values are never copied: every recorded tag
+// keeps a pointer to the payload of its latest poll, and advancing the clock just moves
+// those pointers forward. Writes in the trace are ignored. Once the end is reached the
+// trace starts over from the beginning.
+class OIPReplay {
+public:
+	// where a registered tag gets its value from: a byte offset (and bit) into the
+	// buffer of a recorded tag, non-zero for recorded members like "Data[3]" or "Motor.Speed"
+	struct Source {
+		uint32_t stream = 0;
+		int offset = 0;
+		int bit = -1;
+	};
+
+private:
+	struct Stream {
+		const uint8_t *data = nullptr;
+		size_t size = 0;
+	};
+
+	struct Event {
+		uint64_t timestamp;
+		uint32_t stream;
+		uint16_t size;
+		size_t position;
+	};
+
+	PackedByteArray file;
+	bool loaded = false;
+	std::map<String, Source> sources;
+	std::vector<Stream> streams;
+	std::vector<Event> events;
+	uint64_t duration = 0;
+
+	double speed = 1.0;
+	bool started = false;
+	uint64_t start_ticks = 0;
+	uint64_t cycle = 0;
+	size_t cursor = 0;
+
+public:
+	bool load(const String &path, const String &tag_group_name, String &error);
+	bool is_loaded() const;
+
+	// 1.0 plays the trace in real time, 10.0 ten times faster
+	void set_speed(double p_speed);
+
+	bool find(const String &tag_name, Source &source) const;
+
+	// moves the trace to the position matching the wall clock, the first call starts the clock
+	void advance(uint64_t ticks_usec);
+
+	bool get_value(const Source &source, std::vector<uint8_t> &value) const;
+
+	uint64_t get_duration() const;
+	size_t get_event_count() const;
+};
+
+} //namespace godot
+
+#endif
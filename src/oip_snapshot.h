@@ -0,0 +1,62 @@
+#ifndef OIP_SNAPSHOT_H
+#define OIP_SNAPSHOT_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace godot {
+
+// Hands immutable versions of T from one writer thread to one reader thread without locks.
+//
+// The reader pins the current version for a unit of work and unpins it when done. A
+// version replaced by publish() is kept alive until the reader has been seen unpinned,
+// or pinned again since, which proves it dropped its pointer to the old version. Freeing
+// happens on the writer thread, in publish() and reclaim().
+template <typename T>
+class OIPSnapshot {
+	static const uint64_t IDLE = UINT64_MAX;
+
+	std::atomic<const T *> current{ nullptr };
+	std::atomic<uint64_t> epoch{ 1 };
+	std::atomic<uint64_t> reader_epoch{ IDLE };
+
+	// writer only
+	struct Retired {
+		std::shared_ptr<const T> version;
+		uint64_t epoch;
+	};
+	std::shared_ptr<const T> current_version;
+	std::vector<Retired> retired;
+
+public:
+	void publish(const std::shared_ptr<const T> &version) {
+		if (current_version != nullptr)
+			retired.push_back({ current_version, epoch.load() + 1 });
+		current_version = version;
+		current.store(version.get());
+		epoch.fetch_add(1);
+		reclaim();
+	}
+
+	void reclaim() {
+		const uint64_t seen = reader_epoch.load();
+		retired.erase(std::remove_if(retired.begin(), retired.end(), [seen](const Retired &r) { return seen >= r.epoch; }), retired.end());
+	}
+
+	// the returned version stays valid until the next pin() or unpin()
+	const T *pin() {
+		reader_epoch.store(epoch.load());
+		return current.load();
+	}
+
+	void unpin() {
+		reader_epoch.store(IDLE);
+	}
+};
+
+} //namespace godot
+
+#endif
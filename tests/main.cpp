@@ -0,0 +1,15 @@
+#include "oip_test.h"
+
+int main() {
+	int failed = 0;
+	for (const OIPTestCase &test_case : oip_test_cases()) {
+		int before = oip_test_failures();
+		test_case.run();
+		bool passed = oip_test_failures() == before;
+		if (!passed)
+			failed++;
+		std::printf("%s %s\n", passed ? "PASS" : "FAIL", test_case.name);
+	}
+	std::printf("%d of %d tests passed\n", (int)oip_test_cases().size() - failed, (int)oip_test_cases().size());
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+#ifndef OIP_TEST_H
+#define OIP_TEST_H
+
+#include <cstdio>
+#include <vector>
+
+// A minimal test runner for the parts of the extension which do not need Godot.
+// OIP_TEST registers a test case, OIP_CHECK records a failure and carries on.
+
+struct OIPTestCase {
+	const char *name;
+	void (*run)();
+};
+
+inline std::vector<OIPTestCase> &oip_test_cases() {
+	static std::vector<OIPTestCase> cases;
+	return cases;
+}
+
+inline int &oip_test_failures() {
+	static int failures = 0;
+	return failures;
+}
+
+struct OIPTestRegistrar {
+	OIPTestRegistrar(const char *name, void (*run)()) {
+		oip_test_cases().push_back({ name, run });
+	}
+};
+
+#define OIP_TEST(name)                                                  \
+	static void name();                                                 \
+	static OIPTestRegistrar name##_registrar(#name, name);              \
+	static void name()
+
+#define OIP_CHECK(condition)                                                       \
+	do {                                                                           \
+		if (!(condition)) {                                                        \
+			std::printf("  %s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			oip_test_failures()++;                                                 \
+		}                                                                          \
+	} while (0)
+
+#endif
@@ -0,0 +1,102 @@
+#include "oip_address.h"
+#include "oip_test.h"
+
+#include <climits>
+
+OIP_TEST(split_element_logix) {
+	std::string base;
+	int index = -1, max_span = 0;
+	OIP_CHECK(oip_split_element("Data[12]", base, index, max_span));
+	OIP_CHECK(base == "Data[" && index == 12 && max_span == INT32_MAX);
+
+	// only the last index of a multi dimensional or nested name is split
+	OIP_CHECK(oip_split_element("Program:Main.Data[3][7]", base, index, max_span));
+	OIP_CHECK(base == "Program:Main.Data[3][" && index == 7);
+
+	OIP_CHECK(!oip_split_element("Data[]", base, index, max_span));
+	OIP_CHECK(!oip_split_element("Data[x]", base, index, max_span));
+	OIP_CHECK(!oip_split_element("Data[-1]", base, index, max_span));
+	OIP_CHECK(!oip_split_element("[5]", base, index, max_span));
+	OIP_CHECK(!oip_split_element("Data5]", base, index, max_span));
+	OIP_CHECK(!oip_split_element("Data[12345678901]", base, index, max_span));
+	OIP_CHECK(!oip_split_element("Data", base, index, max_span));
+}
+
+OIP_TEST(split_element_plc5_slc) {
+	std::string base;
+	int index = -1, max_span = 0;
+	OIP_CHECK(oip_split_element("N7:12", base, index, max_span));
+	OIP_CHECK(base == "N7:" && index == 12 && max_span == 118);
+	OIP_CHECK(oip_split_element("F8:0", base, index, max_span));
+	OIP_CHECK(base == "F8:" && index == 0 && max_span == 59);
+	OIP_CHECK(oip_split_element("L20:3", base, index, max_span));
+	OIP_CHECK(max_span == 59);
+
+	// files without a known element size, bit and sub-element addresses are not split
+	OIP_CHECK(!oip_split_element("B3:1", base, index, max_span));
+	OIP_CHECK(!oip_split_element("T4:0.ACC", base, index, max_span));
+	OIP_CHECK(!oip_split_element("N7:1/3", base, index, max_span));
+	OIP_CHECK(!oip_split_element("N:1", base, index, max_span));
+	OIP_CHECK(!oip_split_element("Nx:1", base, index, max_span));
+	OIP_CHECK(!oip_split_element("N7:", base, index, max_span));
+	OIP_CHECK(!oip_split_element("N7:1:2", base, index, max_span));
+}
+
+OIP_TEST(split_bit) {
+	std::string base;
+	int bit = -1;
+	OIP_CHECK(oip_split_bit("Word.5", base, bit));
+	OIP_CHECK(base == "Word" && bit == 5);
+	OIP_CHECK(oip_split_bit("Bits[37]", base, bit));
+	OIP_CHECK(base == "Bits" && bit == 37);
+	OIP_CHECK(oip_split_bit("Udt.Member.31", base, bit));
+	OIP_CHECK(base == "Udt.Member" && bit == 31);
+
+	OIP_CHECK(!oip_split_bit("Udt.Member", base, bit));
+	OIP_CHECK(!oip_split_bit("Word.", base, bit));
+	OIP_CHECK(!oip_split_bit(".5", base, bit));
+	OIP_CHECK(!oip_split_bit("Word", base, bit));
+}
+
+OIP_TEST(modbus_address_tables) {
+	std::string table;
+	int address = -1;
+	OIP_CHECK(oip_modbus_address("hr12", table, address));
+	OIP_CHECK(table == "hr" && address == 12);
+	OIP_CHECK(oip_modbus_address("IR0", table, address));
+	OIP_CHECK(table == "ir" && address == 0);
+	OIP_CHECK(oip_modbus_address("co7", table, address));
+	OIP_CHECK(table == "co" && address == 7);
+	OIP_CHECK(oip_modbus_address("di65535", table, address));
+	OIP_CHECK(table == "di" && address == 65535);
+
+	OIP_CHECK(!oip_modbus_address("hr", table, address));
+	OIP_CHECK(!oip_modbus_address("hr-1", table, address));
+	OIP_CHECK(!oip_modbus_address("hr+1", table, address));
+	OIP_CHECK(!oip_modbus_address("hr1x", table, address));
+	OIP_CHECK(!oip_modbus_address("xx12", table, address));
+}
+
+OIP_TEST(modbus_address_modicon) {
+	std::string table;
+	int address = -1;
+	// 5 and 6 digit numbers are 1-based
+	OIP_CHECK(oip_modbus_address("40013", table, address));
+	OIP_CHECK(table == "hr" && address == 12);
+	OIP_CHECK(oip_modbus_address("400013", table, address));
+	OIP_CHECK(table == "hr" && address == 12);
+	OIP_CHECK(oip_modbus_address("30001", table, address));
+	OIP_CHECK(table == "ir" && address == 0);
+	OIP_CHECK(oip_modbus_address("00001", table, address));
+	OIP_CHECK(table == "co" && address == 0);
+	OIP_CHECK(oip_modbus_address("10010", table, address));
+	OIP_CHECK(table == "di" && address == 9);
+
+	// address 0 does not exist, 2xxxx is not a table, other lengths are not Modicon numbers
+	OIP_CHECK(!oip_modbus_address("40000", table, address));
+	OIP_CHECK(!oip_modbus_address("20001", table, address));
+	OIP_CHECK(!oip_modbus_address("50001", table, address));
+	OIP_CHECK(!oip_modbus_address("4001", table, address));
+	OIP_CHECK(!oip_modbus_address("4000001", table, address));
+	OIP_CHECK(!oip_modbus_address("", table, address));
+}
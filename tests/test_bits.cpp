@@ -0,0 +1,38 @@
+#include "oip_bits.h"
+#include "oip_test.h"
+
+#include <random>
+#include <vector>
+
+using namespace godot;
+
+OIP_TEST(unpack_bits_order) {
+	const uint8_t packed[] = { 0x01, 0x80, 0xA5 };
+	uint8_t bits[24];
+	oip_unpack_bits(packed, 3, bits);
+	OIP_CHECK(bits[0] == 1);
+	for (int i = 1; i < 15; i++)
+		OIP_CHECK(bits[i] == 0);
+	OIP_CHECK(bits[15] == 1);
+	const uint8_t a5[] = { 1, 0, 1, 0, 0, 1, 0, 1 };
+	for (int i = 0; i < 8; i++)
+		OIP_CHECK(bits[16 + i] == a5[i]);
+}
+
+// every size covers the vector loop and the tail, the offsets unaligned loads and stores
+OIP_TEST(unpack_bits_matches_scalar) {
+	std::mt19937 random(1234);
+	for (size_t size = 0; size <= 67; size++) {
+		for (size_t offset = 0; offset < 3; offset++) {
+			std::vector<uint8_t> packed(size + offset);
+			for (uint8_t &byte : packed)
+				byte = (uint8_t)random();
+
+			std::vector<uint8_t> bits(size * 8 + offset + 1, 0xCD);
+			std::vector<uint8_t> expected(size * 8 + offset + 1, 0xCD);
+			oip_unpack_bits(packed.data() + offset, size, bits.data() + offset);
+			oip_unpack_bits_scalar(packed.data() + offset, size, expected.data() + offset);
+			OIP_CHECK(bits == expected);
+		}
+	}
+}
@@ -0,0 +1,74 @@
+#include "oip_create_batch.h"
+#include "oip_test.h"
+
+#include <map>
+
+using namespace godot;
+
+// plc_tag_status stand in, keyed by tag pointer
+struct FakeStatus {
+	std::map<int32_t, int> statuses;
+	int operator()(int32_t tag_pointer) const { return statuses.at(tag_pointer); }
+};
+
+static const OIPCreateBatch::Result *find(const std::vector<OIPCreateBatch::Result> &done, size_t id) {
+	for (const OIPCreateBatch::Result &result : done)
+		if (result.id == id)
+			return &result;
+	return nullptr;
+}
+
+OIP_TEST(create_batch_keeps_pending_tags) {
+	OIPCreateBatch batch;
+	batch.add(0, 10);
+	batch.add(1, 11);
+	FakeStatus status{ { { 10, PLCTAG_STATUS_PENDING }, { 11, PLCTAG_STATUS_PENDING } } };
+
+	std::vector<OIPCreateBatch::Result> done;
+	batch.poll(status, false, done);
+	OIP_CHECK(done.empty());
+	OIP_CHECK(batch.size() == 2);
+}
+
+OIP_TEST(create_batch_finishes_tags_independently) {
+	OIPCreateBatch batch;
+	batch.add(0, 10);
+	batch.add(1, 11);
+	batch.add(2, 12);
+	FakeStatus status{ { { 10, PLCTAG_STATUS_PENDING }, { 11, PLCTAG_STATUS_OK }, { 12, PLCTAG_ERR_NOT_FOUND } } };
+
+	// a failed tag leaves the batch without holding up the others
+	std::vector<OIPCreateBatch::Result> done;
+	batch.poll(status, false, done);
+	OIP_CHECK(done.size() == 2);
+	OIP_CHECK(find(done, 1) != nullptr && find(done, 1)->status == PLCTAG_STATUS_OK && find(done, 1)->tag_pointer == 11);
+	OIP_CHECK(find(done, 2) != nullptr && find(done, 2)->status == PLCTAG_ERR_NOT_FOUND);
+	OIP_CHECK(batch.size() == 1);
+
+	status.statuses[10] = PLCTAG_STATUS_OK;
+	done.clear();
+	batch.poll(status, false, done);
+	OIP_CHECK(done.size() == 1 && done[0].id == 0 && done[0].status == PLCTAG_STATUS_OK);
+	OIP_CHECK(batch.empty());
+}
+
+OIP_TEST(create_batch_times_out_pending_tags) {
+	OIPCreateBatch batch;
+	batch.add(0, 10);
+	batch.add(1, 11);
+	FakeStatus status{ { { 10, PLCTAG_STATUS_PENDING }, { 11, PLCTAG_STATUS_OK } } };
+
+	std::vector<OIPCreateBatch::Result> done;
+	batch.poll(status, true, done);
+	OIP_CHECK(batch.empty());
+	OIP_CHECK(find(done, 0) != nullptr && find(done, 0)->status == PLCTAG_ERR_TIMEOUT);
+	OIP_CHECK(find(done, 1) != nullptr && find(done, 1)->status == PLCTAG_STATUS_OK);
+}
+
+OIP_TEST(create_batch_ready_needs_every_tag) {
+	OIP_CHECK(OIPCreateBatch::ready(0, 0));
+	OIP_CHECK(OIPCreateBatch::ready(3, 3));
+	OIP_CHECK(!OIPCreateBatch::ready(2, 3));
+	// coalesced tags can leave fewer tags than were created before
+	OIP_CHECK(OIPCreateBatch::ready(4, 3));
+}
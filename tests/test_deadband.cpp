@@ -0,0 +1,71 @@
+#include "oip_deadband.h"
+#include "oip_test.h"
+
+using namespace godot;
+
+OIP_TEST(deadband_first_value_passes) {
+	OIPDeadband deadband;
+	deadband.absolute = 1.0;
+	double last = 0.0;
+	bool has_last = false;
+	OIP_CHECK(deadband.exceeded(100.0, last, has_last));
+	OIP_CHECK(has_last && last == 100.0);
+}
+
+OIP_TEST(deadband_absolute) {
+	OIPDeadband deadband;
+	deadband.absolute = 0.5;
+	OIP_CHECK(deadband.enabled());
+	double last = 10.0;
+	bool has_last = true;
+	OIP_CHECK(!deadband.exceeded(10.4, last, has_last));
+	OIP_CHECK(!deadband.exceeded(9.6, last, has_last));
+	OIP_CHECK(last == 10.0);
+	// a change of exactly the deadband is let through and becomes the new last value
+	OIP_CHECK(deadband.exceeded(10.5, last, has_last));
+	OIP_CHECK(last == 10.5);
+	OIP_CHECK(!deadband.exceeded(10.1, last, has_last));
+	OIP_CHECK(deadband.exceeded(9.9, last, has_last));
+}
+
+OIP_TEST(deadband_percent_of_last_value) {
+	OIPDeadband deadband;
+	deadband.percent = 10.0;
+	double last = 200.0;
+	bool has_last = true;
+	OIP_CHECK(!deadband.exceeded(219.0, last, has_last));
+	OIP_CHECK(deadband.exceeded(220.0, last, has_last));
+	// 10 % of 220
+	OIP_CHECK(!deadband.exceeded(198.5, last, has_last));
+	OIP_CHECK(deadband.exceeded(198.0, last, has_last));
+
+	// negative values use the magnitude
+	last = -50.0;
+	OIP_CHECK(!deadband.exceeded(-54.0, last, has_last));
+	OIP_CHECK(deadband.exceeded(-55.0, last, has_last));
+}
+
+OIP_TEST(deadband_larger_threshold_applies) {
+	OIPDeadband deadband;
+	deadband.absolute = 2.0;
+	deadband.percent = 1.0;
+	double last = 100.0;
+	bool has_last = true;
+	// 1 % of 100 is below the absolute deadband
+	OIP_CHECK(!deadband.exceeded(101.5, last, has_last));
+	OIP_CHECK(deadband.exceeded(102.0, last, has_last));
+
+	// 1 % of 1000 is above it
+	last = 1000.0;
+	OIP_CHECK(!deadband.exceeded(1009.0, last, has_last));
+	OIP_CHECK(deadband.exceeded(1010.0, last, has_last));
+}
+
+OIP_TEST(deadband_disabled_passes_every_change) {
+	OIPDeadband deadband;
+	OIP_CHECK(!deadband.enabled());
+	double last = 1.0;
+	bool has_last = true;
+	OIP_CHECK(deadband.exceeded(1.0, last, has_last));
+	OIP_CHECK(deadband.exceeded(1.000001, last, has_last));
+}
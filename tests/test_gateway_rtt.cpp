@@ -0,0 +1,71 @@
+#include "oip_gateway_rtt.h"
+#include "oip_test.h"
+
+#include <cmath>
+
+using namespace godot;
+
+static bool near(double a, double b) {
+	return std::abs(a - b) < 1e-9;
+}
+
+OIP_TEST(gateway_rtt_first_sample) {
+	OIPGatewayRtt rtt;
+	rtt.sample(40.0);
+	OIP_CHECK(near(rtt.srtt, 40.0));
+	OIP_CHECK(near(rtt.rttvar, 20.0));
+}
+
+OIP_TEST(gateway_rtt_smoothing) {
+	OIPGatewayRtt rtt;
+	rtt.sample(40.0);
+	rtt.sample(60.0);
+	// rttvar = 3/4 * 20 + 1/4 * |40 - 60|, then srtt = 7/8 * 40 + 1/8 * 60
+	OIP_CHECK(near(rtt.rttvar, 20.0));
+	OIP_CHECK(near(rtt.srtt, 42.5));
+	rtt.sample(42.5);
+	OIP_CHECK(near(rtt.rttvar, 15.0));
+	OIP_CHECK(near(rtt.srtt, 42.5));
+}
+
+OIP_TEST(gateway_rtt_timeout_needs_samples) {
+	OIPGatewayRtt rtt;
+	for (uint64_t i = 0; i < OIPGatewayRtt::MIN_SAMPLES - 1; i++)
+		rtt.sample(10.0);
+	OIP_CHECK(rtt.timeout(5000) == 5000);
+	rtt.sample(10.0);
+	OIP_CHECK(rtt.timeout(5000) < 5000);
+}
+
+OIP_TEST(gateway_rtt_timeout_bounds) {
+	OIPGatewayRtt steady;
+	for (uint64_t i = 0; i < OIPGatewayRtt::MIN_SAMPLES; i++)
+		steady.sample(100.0);
+	const int expected = (int)(steady.srtt + 4.0 * steady.rttvar);
+	OIP_CHECK(steady.timeout(5000) == expected);
+	OIP_CHECK(steady.timeout(expected - 1) == expected - 1);
+
+	OIPGatewayRtt fast;
+	for (uint64_t i = 0; i < OIPGatewayRtt::MIN_SAMPLES; i++)
+		fast.sample(0.5);
+	OIP_CHECK(fast.timeout(5000) == OIPGatewayRtt::MIN_TIMEOUT);
+}
+
+OIP_TEST(gateway_rtt_back_off) {
+	OIPGatewayRtt rtt;
+	for (uint64_t i = 0; i < OIPGatewayRtt::MIN_SAMPLES; i++)
+		rtt.sample(100.0);
+	const int base = rtt.timeout(1000000);
+	rtt.back_off();
+	OIP_CHECK(rtt.timeout(1000000) == (int)((rtt.srtt + 4.0 * rtt.rttvar) * 2));
+	OIP_CHECK(rtt.timeout(1000000) >= 2 * base);
+
+	for (int i = 0; i < 20; i++)
+		rtt.back_off();
+	OIP_CHECK(rtt.backoff == 64);
+	OIP_CHECK(rtt.timeout(5000) == 5000);
+
+	// an answer resets the back off
+	rtt.sample(100.0);
+	OIP_CHECK(rtt.backoff == 1);
+}
@@ -0,0 +1,192 @@
+#include "oip_recorder.h"
+#include "oip_test.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#ifdef __linux__
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+using namespace godot;
+
+static std::string trace_path(const char *name) {
+	return std::string(P_tmpdir) + "/oip_test_" + name + ".trace";
+}
+
+static std::vector<uint8_t> read_file(const std::string &path) {
+	std::ifstream file(path, std::ios::binary);
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+OIP_TEST(trace_round_trip) {
+	const std::string path = trace_path("round_trip");
+	OIPRecorder recorder;
+	OIP_CHECK(recorder.start(path, 4096));
+	OIP_CHECK(recorder.is_recording());
+
+	const uint32_t block = recorder.define_tag("Line1", "Data[0..3]");
+	const uint32_t member = recorder.define_member("Line1", "Data[2]", block, 8, -1);
+	const uint32_t bit = recorder.define_member("Line1", "Data[0].5", block, 0, 5);
+	const int32_t values[4] = { 1, -2, 3, 400000 };
+	recorder.record(OIPRecorder::RECORD_POLL, block, OIPRecorder::TYPE_RAW, (const uint8_t *)values, sizeof(values));
+	const float speed = 12.5f;
+	recorder.record(OIPRecorder::RECORD_WRITE, member, 8, (const uint8_t *)&speed, sizeof(speed));
+	recorder.stop();
+
+	OIP_CHECK(block == 0 && member == 1 && bit == 2);
+	OIP_CHECK(recorder.get_records() == 5);
+	OIP_CHECK(recorder.get_dropped() == 0);
+
+	const std::vector<uint8_t> file = read_file(path);
+	OIP_CHECK(file.size() == recorder.get_bytes_written());
+	OIP_CHECK(file.size() >= OIPRecorder::FILE_HEADER_SIZE && memcmp(file.data(), "OIPTRACE", 8) == 0);
+
+	OIPTraceReader reader(file.data(), file.size());
+	OIP_CHECK(reader.is_valid());
+
+	OIPTraceReader::Record record;
+	OIP_CHECK(reader.next(record));
+	OIP_CHECK(record.header.kind == OIPRecorder::RECORD_TAG && record.header.tag_id == block);
+	OIP_CHECK(record.tag_group_name == "Line1" && record.tag_name == "Data[0..3]");
+
+	OIP_CHECK(reader.next(record));
+	OIP_CHECK(record.header.kind == OIPRecorder::RECORD_MEMBER && record.header.tag_id == member);
+	OIP_CHECK(record.tag_name == "Data[2]" && record.owner_id == block && record.offset == 8 && record.bit == -1);
+
+	OIP_CHECK(reader.next(record));
+	OIP_CHECK(record.header.kind == OIPRecorder::RECORD_MEMBER && record.tag_name == "Data[0].5" && record.bit == 5);
+
+	OIP_CHECK(reader.next(record));
+	OIP_CHECK(record.header.kind == OIPRecorder::RECORD_POLL && record.header.type == OIPRecorder::TYPE_RAW);
+	OIP_CHECK(record.header.size == sizeof(values) && memcmp(record.payload, values, sizeof(values)) == 0);
+	const uint64_t poll_timestamp = record.header.timestamp;
+
+	OIP_CHECK(reader.next(record));
+	OIP_CHECK(record.header.kind == OIPRecorder::RECORD_WRITE && record.header.tag_id == member && record.header.type == 8);
+	OIP_CHECK(record.header.size == sizeof(speed) && memcmp(record.payload, &speed, sizeof(speed)) == 0);
+	OIP_CHECK(record.header.timestamp >= poll_timestamp);
+
+	OIP_CHECK(!reader.next(record));
+	std::remove(path.c_str());
+}
+
+OIP_TEST(trace_nothing_defined_while_stopped) {
+	OIPRecorder recorder;
+	OIP_CHECK(!recorder.is_recording());
+	OIP_CHECK(recorder.define_tag("Line1", "Speed") == 0);
+	recorder.record(OIPRecorder::RECORD_POLL, 0, 0, nullptr, 0);
+	OIP_CHECK(recorder.get_records() == 0);
+}
+
+OIP_TEST(trace_restart_starts_a_new_session) {
+	const std::string path = trace_path("restart");
+	OIPRecorder recorder;
+	OIP_CHECK(recorder.start(path, 4096));
+	const uint32_t session = recorder.get_session();
+	OIP_CHECK(recorder.define_tag("Line1", "A") == 0);
+	OIP_CHECK(recorder.define_tag("Line1", "B") == 1);
+
+	OIP_CHECK(recorder.start(path, 4096));
+	OIP_CHECK(recorder.get_session() != session);
+	OIP_CHECK(recorder.define_tag("Line1", "B") == 0);
+	recorder.stop();
+	std::remove(path.c_str());
+}
+
+OIP_TEST(trace_full_ring_drops_records) {
+	const std::string path = trace_path("full_ring");
+	OIPRecorder recorder;
+	OIP_CHECK(recorder.start(path, 1024));
+	std::vector<uint8_t> large(2000, 0xAB);
+	recorder.record(OIPRecorder::RECORD_POLL, 0, OIPRecorder::TYPE_RAW, large.data(), large.size());
+	std::vector<uint8_t> oversized(70000, 0);
+	recorder.record(OIPRecorder::RECORD_POLL, 0, OIPRecorder::TYPE_RAW, oversized.data(), oversized.size());
+	recorder.stop();
+	OIP_CHECK(recorder.get_dropped() == 2);
+	OIP_CHECK(recorder.get_records() == 0);
+	std::remove(path.c_str());
+}
+
+OIP_TEST(trace_reader_stops_at_bad_data) {
+	std::vector<uint8_t> file(OIPRecorder::FILE_HEADER_SIZE, 0);
+	memcpy(file.data(), "OIPTRACE", 8);
+	uint32_t version = OIPRecorder::VERSION;
+	memcpy(file.data() + 8, &version, 4);
+
+	// the zeros an unclosed recording ends in
+	std::vector<uint8_t> zeros = file;
+	zeros.resize(zeros.size() + 64, 0);
+	OIPTraceReader::Record record;
+	OIPTraceReader zero_reader(zeros.data(), zeros.size());
+	OIP_CHECK(zero_reader.is_valid());
+	OIP_CHECK(!zero_reader.next(record));
+
+	// a record cut short
+	std::vector<uint8_t> cut = file;
+	OIPRecorder::RecordHeader header = { 8, OIPRecorder::RECORD_POLL, 0, 0, 0 };
+	cut.insert(cut.end(), (const uint8_t *)&header, (const uint8_t *)&header + sizeof(header));
+	cut.resize(cut.size() + 4, 0);
+	OIPTraceReader cut_reader(cut.data(), cut.size());
+	OIP_CHECK(!cut_reader.next(record));
+
+	// another version
+	version++;
+	memcpy(file.data() + 8, &version, 4);
+	OIP_CHECK(!OIPTraceReader(file.data(), file.size()).is_valid());
+	OIP_CHECK(!OIPTraceReader(file.data(), 8).is_valid());
+}
+
+#ifdef __linux__
+// a file size limit between one and two mapping windows makes the second window fail
+OIP_TEST(trace_write_failure_keeps_whole_records) {
+	const std::string path = trace_path("write_failure");
+	rlimit limit;
+	getrlimit(RLIMIT_FSIZE, &limit);
+	const rlimit saved = limit;
+	limit.rlim_cur = 24 * 1024 * 1024;
+	signal(SIGXFSZ, SIG_IGN);
+	setrlimit(RLIMIT_FSIZE, &limit);
+
+	OIPRecorder recorder;
+	OIP_CHECK(recorder.start(path, 1024 * 1024));
+	const uint32_t tag_id = recorder.define_tag("Line1", "Image");
+	std::vector<uint8_t> value(60000, 0x5A);
+	uint64_t pushed = 1;
+	for (int i = 0; i < 1000 && !recorder.has_failed(); i++) {
+		recorder.record(OIPRecorder::RECORD_POLL, tag_id, OIPRecorder::TYPE_RAW, value.data(), value.size());
+		pushed++;
+		std::this_thread::sleep_for(std::chrono::microseconds(500));
+	}
+	OIP_CHECK(recorder.has_failed());
+	OIP_CHECK(!recorder.is_recording());
+
+	// nothing is taken once the writer gave up
+	recorder.record(OIPRecorder::RECORD_POLL, tag_id, OIPRecorder::TYPE_RAW, value.data(), value.size());
+	recorder.stop();
+	OIP_CHECK(!recorder.has_failed());
+	setrlimit(RLIMIT_FSIZE, &saved);
+	signal(SIGXFSZ, SIG_DFL);
+
+	OIP_CHECK(recorder.get_records() + recorder.get_dropped() == pushed);
+	OIP_CHECK(recorder.get_dropped() > 0);
+
+	const std::vector<uint8_t> file = read_file(path);
+	OIP_CHECK(file.size() == recorder.get_bytes_written());
+	OIPTraceReader reader(file.data(), file.size());
+	OIPTraceReader::Record record;
+	uint64_t read = 0;
+	size_t end = OIPRecorder::FILE_HEADER_SIZE;
+	while (reader.next(record)) {
+		read++;
+		end = (record.payload - file.data()) + record.header.size;
+	}
+	OIP_CHECK(read == recorder.get_records());
+	OIP_CHECK(end == file.size());
+	std::remove(path.c_str());
+}
+#endif